@@ -8,6 +8,10 @@
 
 static const uint64_t ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME = 1024 * 256;
 static const uint64_t ImguiBindings_MAX_INDEX_COUNT_PER_FRAME = ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME * 3;
+static const uint64_t ImguiBindings_MAX_QUAD_COUNT_PER_FRAME = ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME / 4;
+static const uint32_t ImguiBindings_MAX_OPAQUE_RECTS = 256;
+// Render/RenderDrawDataSnapshot/RenderToTarget calls between BeginFrames, later calls draw nothing
+static const uint32_t ImguiBindings_MAX_RENDER_CALLS_PER_FRAME = 8;
 
 typedef struct ImguiBindings_Texture {
 	Image_ImageHeader const* cpu;
@@ -23,23 +27,150 @@ typedef struct ImguiBindings_Shared {
 
 } ImguiBindings_Shared;
 
+typedef struct ImguiBindings_TargetDesc {
+	TinyImageFormat format;
+	TheForge_SampleCount sampleCount;
+	uint32_t sampleQuality;
+} ImguiBindings_TargetDesc;
+
+typedef struct ImguiBindings_Rect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+} ImguiBindings_Rect;
+
+// counters for the last finished frame, summed over its render calls. A frame finishes at the next
+// BeginFrame, or at the end of each render call if BeginFrame is never called
+typedef struct ImguiBindings_Stats {
+	uint32_t drawCalls;
+	uint32_t pipelineBinds;
+	uint32_t scissorChanges;
+	uint32_t textureChanges;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t quadInstanceCount;
+	uint32_t clipRectCount; // shader clipping only, commands merge into drawCalls within a draw list
+	uint32_t msaaSampleCount; // 0 when the frame wasn't drawn through the MSAA target
+	uint64_t uploadBytes;
+} ImguiBindings_Stats;
+
 typedef struct ImguiBindings_Context *ImguiBindings_ContextHandle;
+typedef struct ImguiBindings_DrawDataSnapshot *ImguiBindings_DrawDataSnapshotHandle;
 AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_Create(TheForge_RendererHandle renderer,
 																																ShaderCompiler_ContextHandle shaderCompiler,
 																																InputBasic_ContextHandle input,
 																																ImguiBindings_Shared const *shared, // can be null
 																																uint32_t maxDynamicUIUpdatesPerBatch,
 																																uint32_t maxFrames,
+																																// default target, used when Render is passed a null target
 																																TinyImageFormat renderTargetFormat,
 																																TheForge_SampleCount sampleCount,
 																																uint32_t sampleQuality);
+typedef enum ImguiBindings_CreateStatus {
+	ImguiBindings_CS_Pending,
+	ImguiBindings_CS_Ready,
+	ImguiBindings_CS_Failed,
+} ImguiBindings_CreateStatus;
+
+// as Create but shader compiling and font baking run on worker threads (only the triangle shaders, each
+// other mode compiles its own when first enabled or used). Until the status is ready Render does nothing
+// and no ImGui calls may be made on any thread: the font atlas is baked privately and becomes io.Fonts
+// once ready, but allocates through ImGui's allocator meanwhile. The gpu objects (and the atlas
+// upload) are created by the first thread to see the workers finished via GetCreateStatus or Render.
+// That is a hitch, so poll GetCreateStatus from a loading thread rather than leaving it to Render
+AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_CreateAsync(TheForge_RendererHandle renderer,
+																																		 ShaderCompiler_ContextHandle shaderCompiler,
+																																		 InputBasic_ContextHandle input,
+																																		 ImguiBindings_Shared const *shared, // can be null
+																																		 uint32_t maxDynamicUIUpdatesPerBatch,
+																																		 uint32_t maxFrames,
+																																		 TinyImageFormat renderTargetFormat,
+																																		 TheForge_SampleCount sampleCount,
+																																		 uint32_t sampleQuality);
+AL2O3_EXTERN_C ImguiBindings_CreateStatus ImguiBindings_GetCreateStatus(ImguiBindings_ContextHandle handle);
+
 AL2O3_EXTERN_C void ImguiBindings_Destroy(ImguiBindings_ContextHandle handle);
 
+// when enabled axis aligned single colour quads (text and filled rects) are uploaded as compact
+// instances and expanded in the vertex shader, other triangles take the normal path. Quads are
+// drawn ahead of triangles they don't overlap to save draws. Uploads are much smaller but every
+// quad is tested and packed on the CPU, so Render costs more CPU time than the normal path.
+// The index buffer is repacked, so a user callback's IdxOffset doesn't match what is bound in this mode.
+// The first enable compiles the mode's shaders on the calling thread and fails until the context is ready,
+// as do SetShaderClipping and SetMSAAMode. A mode that fails to set up stays off, the others still work
+AL2O3_EXTERN_C bool ImguiBindings_SetQuadExpansion(ImguiBindings_ContextHandle handle, bool enable);
+
+// when enabled clip rects go into a table per render call and are tested in the fragment shader instead of
+// using scissor rects, letting consecutive commands with the same texture within a draw list merge
+// into one draw (each draw list still starts a new draw).
+// Ignored while quad expansion is enabled
+AL2O3_EXTERN_C bool ImguiBindings_SetShaderClipping(ImguiBindings_ContextHandle handle, bool enable);
+
 AL2O3_EXTERN_C void ImguiBindings_SetWindowSize(ImguiBindings_ContextHandle handle, uint32_t width, uint32_t height);
 
 AL2O3_EXTERN_C bool ImguiBindings_UpdateInput(ImguiBindings_ContextHandle handle, double deltaTimeInMS);
 
+// pipelines for each target are created on first use, call this (from any thread) to do it ahead of time.
+// Covers the quad expansion, shader clipping and MSAA (RenderToTarget) pipelines only if those modes
+// are enabled at the time
+AL2O3_EXTERN_C bool ImguiBindings_PrepareTarget(ImguiBindings_ContextHandle handle,
+																								ImguiBindings_TargetDesc const *target);
+
+// starts a new frame of the ring buffers (last used maxFrames frames ago), call once per frame before
+// rendering to draw more than once a frame. Up to ImguiBindings_MAX_RENDER_CALLS_PER_FRAME render calls
+// then share the frame's vertex/index/quad limits and maxDynamicUIUpdatesPerBatch texture changes.
+// If it's never called each render call is a frame of its own, so only one is safe per frame
+AL2O3_EXTERN_C void ImguiBindings_BeginFrame(ImguiBindings_ContextHandle handle);
+
 // returns the frame it just wrote data into, can be ignored except for custom rendering
-AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle, TheForge_CmdHandle cmd);
+AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle,
+																						 TheForge_CmdHandle cmd,
+																						 ImguiBindings_TargetDesc const *target); // can be null
+
+// copies the current ImGui::GetDrawData() into a pooled snapshot owned by the caller until released,
+// so the UI thread can build the next frame while another thread renders this one.
+// Callbacks in a snapshot get a null parent list. All snapshots must be released before Destroy
+AL2O3_EXTERN_C ImguiBindings_DrawDataSnapshotHandle ImguiBindings_CaptureDrawData(ImguiBindings_ContextHandle handle);
+AL2O3_EXTERN_C uint32_t ImguiBindings_RenderDrawDataSnapshot(ImguiBindings_ContextHandle handle,
+																														 TheForge_CmdHandle cmd,
+																														 ImguiBindings_TargetDesc const *target, // can be null
+																														 ImguiBindings_DrawDataSnapshotHandle snapshot);
+AL2O3_EXTERN_C void ImguiBindings_ReleaseDrawDataSnapshot(ImguiBindings_ContextHandle handle,
+																													ImguiBindings_DrawDataSnapshotHandle snapshot);
 
 AL2O3_EXTERN_C float const* ImguiBindings_GetScaleOffsetMatrix(ImguiBindings_ContextHandle handle);
+AL2O3_EXTERN_C ImguiBindings_Stats const* ImguiBindings_GetStats(ImguiBindings_ContextHandle handle);
+
+// conservative rects (in render target pixels) fully covered by opaque UI fills, from the snapshot
+// or the live draw data if snapshot is null. Only solid fills at full alpha count, so window
+// backgrounds need an opaque style colour. Pointer is valid until the next call
+AL2O3_EXTERN_C ImguiBindings_Rect const* ImguiBindings_ComputeOpaqueRects(ImguiBindings_ContextHandle handle,
+																																				 ImguiBindings_DrawDataSnapshotHandle snapshot,
+																																				 uint32_t* rectCount);
+// writes depth into the bound depth target for the last computed opaque rects (no colour writes),
+// call before the scene pass so it can early out under the UI. The rects are scaled from the UI
+// target to the depth target's size, so the two can differ (e.g. a scene at a lower resolution).
+// The first call compiles the mask shaders
+AL2O3_EXTERN_C void ImguiBindings_RenderOpaqueMask(ImguiBindings_ContextHandle handle,
+																									 TheForge_CmdHandle cmd,
+																									 ImguiBindings_TargetDesc const* depthTarget,
+																									 uint32_t depthTargetWidth,
+																									 uint32_t depthTargetHeight,
+																									 float depth);
+
+// MSAA mode for RenderToTarget: turns off ImGui's AntiAliasedLines/AntiAliasedFill fringe geometry
+// and draws into an MSAA target the bindings own, resolved onto the caller's target. SC_1 turns it
+// off and restores the style flags. Call it where ImGui's style may be changed (the UI thread); it
+// only records the sample count for the render thread. The next RenderToTarget replaces (or for SC_1
+// releases) the MSAA target, the old one is removed maxFrames frames later once no frame in flight
+// uses it. Call PrepareTarget after it to create the MSAA pipelines ahead of time
+AL2O3_EXTERN_C bool ImguiBindings_SetMSAAMode(ImguiBindings_ContextHandle handle, TheForge_SampleCount sampleCount);
+// binds target (which must be in the render target state) and renders the snapshot, or the live
+// draw data if snapshot is null, through the MSAA target when MSAA mode is on. target is left
+// bound. The MSAA target follows target's size and format, recreated when either changes. If it can't
+// be created the call draws straight into target, and that size, format and count isn't tried again
+AL2O3_EXTERN_C uint32_t ImguiBindings_RenderToTarget(ImguiBindings_ContextHandle handle,
+																										 TheForge_CmdHandle cmd,
+																										 TheForge_RenderTargetHandle target,
+																										 ImguiBindings_DrawDataSnapshotHandle snapshot /*can be null*/);
@@ -1,7 +1,10 @@
 #include "al2o3_platform/platform.h"
 #include "al2o3_memory/memory.h"
 #include "gfx_imgui_al2o3_theforge_bindings/bindings.h"
+#include "al2o3_thread/thread.h"
+#include "al2o3_thread/atomic.h"
 #include "gfx_imgui/imgui.h"
+#include <math.h>
 
 enum InputIds {
 	MouseX,
@@ -10,6 +13,161 @@ enum InputIds {
 	MouseRightClick,
 };
 
+// compact per instance record for an axis aligned single colour quad (28 bytes vs 4 ImDrawVert + 6 ImDrawIdx)
+struct QuadInstance {
+	float rect[4];
+	uint16_t uvRect[4];
+	uint32_t colour;
+};
+
+// primitives of one draw command that go down the same path and are drawn together
+struct QuadRun {
+	uint32_t cmdIndex; // sequential index of the non callback draw command this run belongs to
+	bool quad;
+	uint32_t first; // first instance for quad runs, first index for triangle runs
+	uint32_t count; // instance count for quad runs, index count for triangle runs
+	uint32_t vertexBase; // triangle runs only
+};
+
+// bounds of what the last run of a command covers. A primitive can join the previous run of its
+// kind (so is drawn before the last run) if it doesn't overlap any of them. Neighbouring glyphs
+// share a box, so a line of text costs one
+static const uint32_t MAX_OVERLAP_BOXES = 256;
+struct OverlapBox {
+	float x0, y0, x1, y1;
+};
+struct OverlapTracker {
+	uint32_t count;
+	OverlapBox boxes[MAX_OVERLAP_BOXES];
+};
+
+// binding side view of one ImDrawList, pointing either at live ImGui data or into a snapshot
+struct DrawListView {
+	ImDrawList const *source; // passed to user callbacks, nullptr for snapshots as the list has moved on
+	ImDrawCmd const *cmds;
+	ImDrawIdx const *indices;
+	ImDrawVert const *vertices;
+	uint32_t cmdCount;
+	uint32_t indexCount;
+	uint32_t vertexCount;
+};
+
+struct DrawFrame {
+	ImVec2 displayPos;
+	ImVec2 displaySize;
+	ImVec2 framebufferScale;
+	DrawListView const *lists;
+	uint32_t listCount;
+};
+
+// all lists are packed into shared grow only arrays, so a reused snapshot doesn't allocate
+struct ImguiBindings_DrawDataSnapshot {
+	ImguiBindings_DrawDataSnapshot *nextFree;
+	DrawFrame frame;
+
+	DrawListView *lists;
+	uint32_t listCapacity;
+	ImDrawCmd *cmds;
+	uint32_t cmdCapacity;
+	ImDrawIdx *indices;
+	uint32_t indexCapacity;
+	ImDrawVert *vertices;
+	uint32_t vertexCapacity;
+};
+
+enum PipelineKind {
+	PK_Triangles,
+	PK_Quads,
+	PK_Clip,
+};
+
+// pipelines for one render target description, created on first use. The quad and clip pipelines
+// are only created once those modes draw to the target, readyMask has bit (1 << kind) set after
+struct PipelineVariant {
+	ImguiBindings_TargetDesc target;
+	bool offscreen;
+	TheForge_PipelineHandle pipeline;
+	TheForge_PipelineHandle quadPipeline;
+	TheForge_PipelineHandle clipPipeline;
+	Thread_Atomic32_t readyMask;
+};
+
+static const uint32_t MAX_PIPELINE_VARIANTS = 16;
+
+static const uint32_t MAX_CLIP_RECTS_PER_FRAME = 1024;
+
+// a single pipeline for one target description (opaque mask, MSAA resolve)
+struct TargetPipeline {
+	ImguiBindings_TargetDesc target;
+	TheForge_PipelineHandle pipeline;
+};
+
+// a replaced MSAA target may still be used by frames in flight, so it's removed maxFrames frames later
+static const uint32_t MAX_RETIRED_MSAA_TARGETS = 8;
+struct RetiredTarget {
+	TheForge_RenderTargetHandle target;
+	uint32_t framesLeft;
+};
+
+// two triangles of float3 per rect
+static const uint32_t MASK_VERTICES_PER_RECT = 6;
+static const uint64_t MASK_VERTEX_SIZE = sizeof(float) * 3;
+
+// creation compiles just the triangle shaders, SetupMode compiles the rest
+enum CreateJobs {
+	CJ_VertexShader,
+	CJ_FragmentShader,
+	CJ_FontAtlas,
+	CJ_COUNT
+};
+
+// cpu side of context creation, run on worker threads for CreateAsync
+struct CreateJob {
+	ImguiBindings_Context *ctx;
+	bool (*func)(CreateJob *job);
+
+	ShaderCompiler_ShaderType shaderType;
+	char const *name;
+	char const *source;
+	ShaderCompiler_Output output;
+};
+
+// the shader compiler context isn't documented as thread safe, so one worker compiles both
+// shaders in turn while another bakes the font atlas
+enum CreateWorkers {
+	CW_Shaders,
+	CW_FontAtlas,
+	CW_COUNT
+};
+
+struct CreateWorker {
+	ImguiBindings_Context *ctx;
+	uint32_t firstJob;
+	uint32_t jobCount;
+
+	Thread_Thread thread;
+	bool threaded;
+};
+
+// each mode's shaders and gpu objects are set up the first time it's enabled (or for the opaque mask,
+// drawn). A failed setup is remembered and only turns that mode off
+enum Modes {
+	MD_QuadExpansion,
+	MD_ShaderClipping,
+	MD_OpaqueMask,
+	MD_MSAA,
+	MD_COUNT
+};
+
+enum ModeSetup {
+	MS_NotSetUp,
+	MS_Ready,
+	MS_Failed
+};
+
+// quad instances are built in a batch this size, small enough to stay in cache, then copied to the quad buffer
+static const uint32_t QUAD_BATCH_SIZE = 256;
+
 struct ImguiBindings_Context {
 	TheForge_RendererHandle renderer;
 	ShaderCompiler_ContextHandle shaderCompiler;
@@ -22,6 +180,15 @@ struct ImguiBindings_Context {
 	uint32_t maxFrames;
 
 	uint32_t currentFrame;
+	// how much of the current frame's region earlier render calls used, calls sub-allocate after it.
+	// Without BeginFrame every render call moves on to a new frame
+	bool explicitFrames;
+	uint32_t frameCallCount;
+	uint32_t frameVertexCount;
+	uint32_t frameIndexCount;
+	uint32_t frameQuadCount;
+	uint32_t frameTextureChangeCount;
+	uint32_t frameMaskRectCount;
 
 	bool sharedState;
 	TheForge_SamplerHandle bilinearSampler;
@@ -31,14 +198,99 @@ struct ImguiBindings_Context {
 
 	TheForge_ShaderHandle shader;
 	TheForge_RootSignatureHandle rootSignature;
-	TheForge_PipelineHandle pipeline;
+	TheForge_VertexLayout const *vertexLayout;
+	ImguiBindings_TargetDesc defaultTarget;
+	// pipeline caches only grow and entries never move, an entry is filled in before the count is
+	// released past it so lookups don't lock. The mutex only orders adding entries
+	Thread_Mutex pipelineMutex;
+	PipelineVariant pipelineVariants[MAX_PIPELINE_VARIANTS];
+	Thread_Atomic32_t pipelineVariantCount;
 	TheForge_DescriptorSetHandle descriptorSetTexture;
 	TheForge_DescriptorSetHandle descriptorSetUniform;
 	TheForge_BufferHandle vertexBuffer;
 	TheForge_BufferHandle indexBuffer;
 	TheForge_BufferHandle *uniformBuffers;
 
+	// modes are set from any thread, RenderFrame reads each once per call
+	Thread_Atomic32_t quadExpansion;
+	TheForge_ShaderHandle quadShader;
+	TheForge_ShaderHandle clipShader;
+	TheForge_ShaderHandle maskShader;
+	TheForge_ShaderHandle resolveShader;
+	TheForge_BufferHandle quadBuffer;
+	QuadRun *quadRuns;
+	uint32_t quadRunCapacity;
+
+	Thread_Atomic32_t shaderClipping;
+	// clip tables are an extra resource, so shader clipping has its own root signature and sets
+	TheForge_RootSignatureHandle clipRootSignature;
+	TheForge_DescriptorSetHandle clipDescriptorSetTexture;
+	TheForge_DescriptorSetHandle clipDescriptorSetUniform;
+	TheForge_BufferHandle *clipTableBuffers;
+	TheForge_BufferHandle clipIndexBuffer;
+	float *clipTableStaging;
+	uint32_t *clipIndexStaging;
+
+	TheForge_RootSignatureHandle maskRootSignature;
+	TheForge_DepthStateHandle maskDepthState;
+	TheForge_BufferHandle maskVertexBuffer;
+	TargetPipeline maskPipelineVariants[MAX_PIPELINE_VARIANTS];
+	Thread_Atomic32_t maskPipelineVariantCount;
+	ImguiBindings_Rect opaqueRects[ImguiBindings_MAX_OPAQUE_RECTS];
+	uint32_t opaqueRectCount;
+	float opaqueTargetWidth;
+	float opaqueTargetHeight;
+
+	// MSAA mode, SC_1 when off. ImGui's own AA flags are saved while it's on. SetMSAAMode only
+	// records the count, the MSAA target is retired and rebuilt by RenderToTarget on the render thread
+	Thread_Atomic32_t msaaSampleCount;
+	bool savedAntiAliasedLines;
+	bool savedAntiAliasedFill;
+	TheForge_RenderTargetHandle msaaTarget;
+	RetiredTarget retiredMsaaTargets[MAX_RETIRED_MSAA_TARGETS];
+	uint32_t retiredMsaaTargetCount;
+	// the last MSAA target AddRenderTarget failed on, not tried again until something changes
+	TheForge_RenderTargetDesc failedMsaaDesc;
+	TheForge_BlendStateHandle offscreenBlendState;
+	TheForge_BlendStateHandle resolveBlendState;
+	TheForge_RootSignatureHandle resolveRootSignature;
+	TheForge_DescriptorSetHandle resolveDescriptorSet;
+	TargetPipeline resolvePipelines[MAX_PIPELINE_VARIANTS];
+	Thread_Atomic32_t resolvePipelineCount;
+
+	// summed over the current frame's render calls, becomes stats when the frame advances
+	ImguiBindings_Stats frameStats;
+	ImguiBindings_Stats stats;
+
+	DrawListView *liveLists;
+	uint32_t liveListCapacity;
+
+	Thread_Mutex snapshotMutex;
+	ImguiBindings_DrawDataSnapshot *freeSnapshots;
+
 	ImguiBindings_Texture fontTexture;
+	// baked privately by a worker, becomes io.Fonts when creation finishes
+	ImFontAtlas *fontAtlas;
+	bool fontAtlasInstalled;
+	unsigned char *fontPixels;
+	int fontWidth;
+	int fontHeight;
+
+	bool hasShared;
+	ImguiBindings_Shared shared;
+
+	// set once creation has finished, so the render calls can skip createMutex
+	Thread_Atomic32_t createFinished;
+	// a ModeSetup per mode, changed under createMutex which then also guards the shader compiler
+	Thread_Atomic32_t modeSetup[MD_COUNT];
+
+	// everything below is guarded by createMutex
+	Thread_Mutex createMutex;
+	ImguiBindings_CreateStatus createStatus;
+	uint32_t createJobsRemaining;
+	bool createJobFailed;
+	CreateJob createJobs[CJ_COUNT];
+	CreateWorker createWorkers[CW_COUNT];
 
 	float scaleOffsetMatrix[16];
 
@@ -47,127 +299,335 @@ struct ImguiBindings_Context {
 
 static const uint64_t UNIFORM_BUFFER_SIZE_PER_FRAME = 256;
 
-static bool CreateShaders(ImguiBindings_Context *ctx) {
-	static char const *const VertexShader = "cbuffer uniformBlockVS : register(b0, space0)\n"
-																					"{\n"
-																					"\tfloat4x4 ProjectionMatrix;\n"
-																					"};\n"
-																					"struct VSInput\n"
-																					"{\n"
-																					"\tfloat2 Position : POSITION;\n"
-																					"\tfloat2 Uv 			 : TEXCOORD0;\n"
-																					"\tfloat4 Colour   : COLOR;\n"
-																					"};\n"
-																					"\n"
-																					"struct VSOutput {\n"
-																					"\tfloat4 Position : SV_POSITION;\n"
-																					"\tfloat2 Uv 			 : TEXCOORD0;\n"
-																					"\tfloat4 Colour   : COLOR;\n"
-																					"};\n"
-																					"\n"
-																					"VSOutput VS_main(VSInput input)\n"
-																					"{\n"
-																					"    VSOutput result;\n"
-																					"\n"
-																					"\tresult.Position = mul(ProjectionMatrix, float4(input.Position, 0.f, 1.f));\n"
-																					"\tresult.Uv = input.Uv;\n"
-																					"\tresult.Colour = input.Colour;\n"
-																					"\treturn result;\n"
-																					"}";
-	static char const *const FragmentShader = "struct FSInput {\n"
+static char const *const VertexShader = "cbuffer uniformBlockVS : register(b0, space0)\n"
+																				"{\n"
+																				"\tfloat4x4 ProjectionMatrix;\n"
+																				"};\n"
+																				"struct VSInput\n"
+																				"{\n"
+																				"\tfloat2 Position : POSITION;\n"
+																				"\tfloat2 Uv 			 : TEXCOORD0;\n"
+																				"\tfloat4 Colour   : COLOR;\n"
+																				"};\n"
+																				"\n"
+																				"struct VSOutput {\n"
+																				"\tfloat4 Position : SV_POSITION;\n"
+																				"\tfloat2 Uv 			 : TEXCOORD0;\n"
+																				"\tfloat4 Colour   : COLOR;\n"
+																				"};\n"
+																				"\n"
+																				"VSOutput VS_main(VSInput input)\n"
+																				"{\n"
+																				"    VSOutput result;\n"
+																				"\n"
+																				"\tresult.Position = mul(ProjectionMatrix, float4(input.Position, 0.f, 1.f));\n"
+																				"\tresult.Uv = input.Uv;\n"
+																				"\tresult.Colour = input.Colour;\n"
+																				"\treturn result;\n"
+																				"}";
+// per instance axis aligned quad, expanded from SV_VertexID as two triangles (0,1,2) (0,2,3)
+// with the same corner order ImDrawList::PrimRectUV uses
+static char const *const QuadVertexShader = "cbuffer uniformBlockVS : register(b0, space0)\n"
+																						"{\n"
+																						"\tfloat4x4 ProjectionMatrix;\n"
+																						"};\n"
+																						"struct VSInput\n"
+																						"{\n"
+																						"\tfloat4 Rect     : POSITION;\n"
+																						"\tfloat4 UvRect 	 : TEXCOORD0;\n"
+																						"\tfloat4 Colour   : COLOR;\n"
+																						"\tuint VertexId   : SV_VertexID;\n"
+																						"};\n"
+																						"\n"
+																						"struct VSOutput {\n"
 																						"\tfloat4 Position : SV_POSITION;\n"
-																						"\tfloat2 Uv 			 : TEXCOORD;\n"
+																						"\tfloat2 Uv 			 : TEXCOORD0;\n"
 																						"\tfloat4 Colour   : COLOR;\n"
 																						"};\n"
 																						"\n"
-																						"Texture2D colourTexture : register(t1, space2);\n"
-																						"SamplerState bilinearSampler : register(s1, space0);\n"
-																						"float4 FS_main(FSInput input) : SV_Target\n"
+																						"VSOutput VS_main(VSInput input)\n"
 																						"{\n"
-																						"\treturn input.Colour * colourTexture.Sample(bilinearSampler, input.Uv);\n"
-																						"}\n";
-
-	static char const *const vertEntryPoint = "VS_main";
-	static char const *const fragEntryPoint = "FS_main";
-
-	VFile_Handle vfile = VFile_FromMemory(VertexShader, strlen(VertexShader) + 1, false);
-	if (!vfile) {
-		return false;
-	}
-	VFile_Handle ffile = VFile_FromMemory(FragmentShader, strlen(FragmentShader) + 1, false);
-	if (!ffile) {
-		VFile_Close(vfile);
+																						"    VSOutput result;\n"
+																						"\n"
+																						"\tuint corner = input.VertexId < 3 ? input.VertexId : (input.VertexId == 3 ? 0 : input.VertexId - 2);\n"
+																						"\tfloat2 t = float2((corner == 1 || corner == 2) ? 1.f : 0.f, corner >= 2 ? 1.f : 0.f);\n"
+																						"\tresult.Position = mul(ProjectionMatrix, float4(lerp(input.Rect.xy, input.Rect.zw, t), 0.f, 1.f));\n"
+																						"\tresult.Uv = lerp(input.UvRect.xy, input.UvRect.zw, t);\n"
+																						"\tresult.Colour = input.Colour;\n"
+																						"\treturn result;\n"
+																						"}";
+// clip rects are looked up per vertex and tested per pixel, so draws within a draw list with different
+// clip rects can merge. The clip index has its own semantic so it can't be confused with the uvs.
+// ClipRects size must match MAX_CLIP_RECTS_PER_FRAME
+static char const *const ClipVertexShader = "cbuffer uniformBlockVS : register(b0, space0)\n"
+																						"{\n"
+																						"\tfloat4x4 ProjectionMatrix;\n"
+																						"};\n"
+																						"cbuffer clipTableVS : register(b1, space0)\n"
+																						"{\n"
+																						"\tfloat4 ClipRects[1024];\n"
+																						"};\n"
+																						"struct VSInput\n"
+																						"{\n"
+																						"\tfloat2 Position : POSITION;\n"
+																						"\tfloat2 Uv 			 : TEXCOORD0;\n"
+																						"\tfloat4 Colour   : COLOR;\n"
+																						"\tuint ClipIndex  : CLIPINDEX;\n"
+																						"};\n"
+																						"\n"
+																						"struct VSOutput {\n"
+																						"\tfloat4 Position : SV_POSITION;\n"
+																						"\tfloat2 Uv 			 : TEXCOORD0;\n"
+																						"\tfloat4 Colour   : COLOR;\n"
+																						"\tnointerpolation float4 ClipRect : TEXCOORD1;\n"
+																						"};\n"
+																						"\n"
+																						"VSOutput VS_main(VSInput input)\n"
+																						"{\n"
+																						"    VSOutput result;\n"
+																						"\n"
+																						"\tresult.Position = mul(ProjectionMatrix, float4(input.Position, 0.f, 1.f));\n"
+																						"\tresult.Uv = input.Uv;\n"
+																						"\tresult.Colour = input.Colour;\n"
+																						"\tresult.ClipRect = ClipRects[input.ClipIndex];\n"
+																						"\treturn result;\n"
+																						"}";
+static char const *const ClipFragmentShader = "struct FSInput {\n"
+																							"\tfloat4 Position : SV_POSITION;\n"
+																							"\tfloat2 Uv 			 : TEXCOORD0;\n"
+																							"\tfloat4 Colour   : COLOR;\n"
+																							"\tnointerpolation float4 ClipRect : TEXCOORD1;\n"
+																							"};\n"
+																							"\n"
+																							"Texture2D colourTexture : register(t1, space2);\n"
+																							"SamplerState bilinearSampler : register(s1, space0);\n"
+																							"float4 FS_main(FSInput input) : SV_Target\n"
+																							"{\n"
+																							"\tif (any(input.Position.xy < input.ClipRect.xy) || any(input.Position.xy >= input.ClipRect.zw)) {\n"
+																							"\t\tdiscard;\n"
+																							"\t}\n"
+																							"\treturn input.Colour * colourTexture.Sample(bilinearSampler, input.Uv);\n"
+																							"}\n";
+// opaque mask rects arrive already in clip space with the mask depth in z, only depth is written
+static char const *const MaskVertexShader = "struct VSInput\n"
+																						"{\n"
+																						"\tfloat3 Position : POSITION;\n"
+																						"};\n"
+																						"\n"
+																						"struct VSOutput {\n"
+																						"\tfloat4 Position : SV_POSITION;\n"
+																						"};\n"
+																						"\n"
+																						"VSOutput VS_main(VSInput input)\n"
+																						"{\n"
+																						"    VSOutput result;\n"
+																						"\n"
+																						"\tresult.Position = float4(input.Position, 1.f);\n"
+																						"\treturn result;\n"
+																						"}";
+static char const *const MaskFragmentShader = "struct FSInput {\n"
+																							"\tfloat4 Position : SV_POSITION;\n"
+																							"};\n"
+																							"\n"
+																							"void FS_main(FSInput input)\n"
+																							"{\n"
+																							"}\n";
+// fullscreen triangle from the vertex id, averages every sample of the MSAA target
+static char const *const ResolveVertexShader = "struct VSOutput {\n"
+																							 "\tfloat4 Position : SV_POSITION;\n"
+																							 "};\n"
+																							 "\n"
+																							 "VSOutput VS_main(uint vertexId : SV_VertexID)\n"
+																							 "{\n"
+																							 "    VSOutput result;\n"
+																							 "\n"
+																							 "\tfloat2 uv = float2((vertexId << 1) & 2, vertexId & 2);\n"
+																							 "\tresult.Position = float4(uv * float2(2.f, -2.f) + float2(-1.f, 1.f), 0.f, 1.f);\n"
+																							 "\treturn result;\n"
+																							 "}";
+static char const *const ResolveFragmentShader = "struct FSInput {\n"
+																								 "\tfloat4 Position : SV_POSITION;\n"
+																								 "};\n"
+																								 "\n"
+																								 "Texture2DMS<float4> msaaTexture : register(t0, space0);\n"
+																								 "\n"
+																								 "float4 FS_main(FSInput input) : SV_Target\n"
+																								 "{\n"
+																								 "\tuint width, height, sampleCount;\n"
+																								 "\tmsaaTexture.GetDimensions(width, height, sampleCount);\n"
+																								 "\tint2 texel = int2(input.Position.xy);\n"
+																								 "\tfloat4 colour = float4(0.f, 0.f, 0.f, 0.f);\n"
+																								 "\tfor (uint i = 0; i < sampleCount; ++i) {\n"
+																								 "\t\tcolour += msaaTexture.Load(texel, i);\n"
+																								 "\t}\n"
+																								 "\treturn colour / float(sampleCount);\n"
+																								 "}\n";
+static char const *const FragmentShader = "struct FSInput {\n"
+																					"\tfloat4 Position : SV_POSITION;\n"
+																					"\tfloat2 Uv 			 : TEXCOORD;\n"
+																					"\tfloat4 Colour   : COLOR;\n"
+																					"};\n"
+																					"\n"
+																					"Texture2D colourTexture : register(t1, space2);\n"
+																					"SamplerState bilinearSampler : register(s1, space0);\n"
+																					"float4 FS_main(FSInput input) : SV_Target\n"
+																					"{\n"
+																					"\treturn input.Colour * colourTexture.Sample(bilinearSampler, input.Uv);\n"
+																					"}\n";
+
+static bool CompileShader(ImguiBindings_Context *ctx,
+													ShaderCompiler_ShaderType type,
+													char const *name,
+													char const *entryPoint,
+													char const *source,
+													ShaderCompiler_Output *out) {
+	*out = {};
+	VFile_Handle file = VFile_FromMemory(source, strlen(source) + 1, false);
+	if (!file) {
 		return false;
 	}
 
-	ShaderCompiler_Output vout;
-	bool vokay = ShaderCompiler_Compile(
-			ctx->shaderCompiler, ShaderCompiler_ST_VertexShader,
-			"ImguiBindings_VertexShader", vertEntryPoint, vfile,
-			&vout);
-	if (vout.log != nullptr) {
-		LOGWARNING("Shader compiler : %s %s", vokay ? "warnings" : "ERROR", vout.log);
+	bool okay = ShaderCompiler_Compile(ctx->shaderCompiler, type, name, entryPoint, file, out);
+	if (out->log != nullptr) {
+		LOGWARNING("Shader compiler : %s %s", okay ? "warnings" : "ERROR", out->log);
 	}
-	ShaderCompiler_Output fout;
-	bool fokay = ShaderCompiler_Compile(
-			ctx->shaderCompiler, ShaderCompiler_ST_FragmentShader,
-			"ImguiBindings_FragmentShader", fragEntryPoint, ffile,
-			&fout);
-	if (fout.log != nullptr) {
-		LOGWARNING("Shader compiler : %s %s", fokay ? "warnings" : "ERROR", fout.log);
-	}
-	VFile_Close(vfile);
-	VFile_Close(ffile);
+	VFile_Close(file);
+	return okay;
+}
 
-	if (!vokay || !fokay) {
-		MEMORY_FREE((void *) vout.log);
-		MEMORY_FREE((void *) vout.shader);
-		MEMORY_FREE((void *) fout.log);
-		MEMORY_FREE((void *) fout.shader);
-		return false;
-	}
+static void AddShader(ImguiBindings_Context *ctx,
+											char const *vertName, ShaderCompiler_Output const *vout,
+											char const *fragName, ShaderCompiler_Output const *fout,
+											TheForge_ShaderHandle *shader) {
+	static char const *const vertEntryPoint = "VS_main";
+	static char const *const fragEntryPoint = "FS_main";
 
 #if AL2O3_PLATFORM == AL2O3_PLATFORM_APPLE_MAC
 	TheForge_ShaderDesc sdesc;
 	sdesc.stages = (TheForge_ShaderStage) (TheForge_SS_FRAG | TheForge_SS_VERT);
-	sdesc.vert.name = "ImguiBindings_VertexShader";
-	sdesc.vert.code = (char *) vout.shader;
+	sdesc.vert.name = vertName;
+	sdesc.vert.code = (char *) vout->shader;
 	sdesc.vert.entryPoint = vertEntryPoint;
-	sdesc.frag.name = "ImguiBindings_FragmentShader";
-	sdesc.frag.code = (char *) fout.shader;
+	sdesc.frag.name = fragName;
+	sdesc.frag.code = (char *) fout->shader;
 	sdesc.frag.entryPoint = fragEntryPoint;
-	TheForge_AddShader(ctx->renderer, &sdesc, &ctx->shader);
+	TheForge_AddShader(ctx->renderer, &sdesc, shader);
 #else
 	TheForge_BinaryShaderDesc bdesc;
 	bdesc.stages = (TheForge_ShaderStage) (TheForge_SS_FRAG | TheForge_SS_VERT);
-	bdesc.vert.byteCode = (char *) vout.shader;
-	bdesc.vert.byteCodeSize = (uint32_t) vout.shaderSize;
+	bdesc.vert.byteCode = (char *) vout->shader;
+	bdesc.vert.byteCodeSize = (uint32_t) vout->shaderSize;
 	bdesc.vert.entryPoint = vertEntryPoint;
-	bdesc.frag.byteCode = (char *) fout.shader;
-	bdesc.frag.byteCodeSize = (uint32_t) fout.shaderSize;
+	bdesc.frag.byteCode = (char *) fout->shader;
+	bdesc.frag.byteCodeSize = (uint32_t) fout->shaderSize;
 	bdesc.frag.entryPoint = fragEntryPoint;
-	TheForge_AddShaderBinary(ctx->renderer, &bdesc, &ctx->shader);
+	TheForge_AddShaderBinary(ctx->renderer, &bdesc, shader);
 #endif
-	MEMORY_FREE((void *) vout.log);
-	MEMORY_FREE((void *) vout.shader);
-	MEMORY_FREE((void *) fout.log);
-	MEMORY_FREE((void *) fout.shader);
-	return true;
+}
+
+static void FreeShaderOutput(ShaderCompiler_Output *out) {
+	MEMORY_FREE((void *) out->log);
+	MEMORY_FREE((void *) out->shader);
+	out->log = nullptr;
+	out->shader = nullptr;
+}
+
+static bool CompileShaderJob(CreateJob *job) {
+	char const *entryPoint = (job->shaderType == ShaderCompiler_ST_VertexShader) ? "VS_main" : "FS_main";
+	return CompileShader(job->ctx, job->shaderType, job->name, entryPoint, job->source, &job->output);
+}
+
+// for the mode shaders, compiled on the calling thread once creation has finished
+static bool CompileAndAddShader(ImguiBindings_Context *ctx,
+																char const *vertName, char const *vertSource,
+																char const *fragName, char const *fragSource,
+																TheForge_ShaderHandle *shader) {
+	ShaderCompiler_Output vout{};
+	ShaderCompiler_Output fout{};
+	if (CompileShader(ctx, ShaderCompiler_ST_VertexShader, vertName, "VS_main", vertSource, &vout) &&
+			CompileShader(ctx, ShaderCompiler_ST_FragmentShader, fragName, "FS_main", fragSource, &fout)) {
+		AddShader(ctx, vertName, &vout, fragName, &fout, shader);
+	}
+	FreeShaderOutput(&vout);
+	FreeShaderOutput(&fout);
+	return *shader != nullptr;
+}
+
+// only touches the private atlas, though ImGui's allocator still counts into the current context
+static bool BakeFontAtlasJob(CreateJob *job) {
+	ImguiBindings_Context *ctx = job->ctx;
+	ctx->fontAtlas->AddFontDefault();
+	ctx->fontAtlas->GetTexDataAsRGBA32(&ctx->fontPixels, &ctx->fontWidth, &ctx->fontHeight);
+	return ctx->fontPixels != nullptr;
+}
+
+static void RunCreateJob(CreateJob *job) {
+	bool const okay = job->func(job);
+
+	ImguiBindings_Context *ctx = job->ctx;
+	Thread_MutexAcquire(&ctx->createMutex);
+	ctx->createJobFailed |= !okay;
+	ctx->createJobsRemaining--;
+	Thread_MutexRelease(&ctx->createMutex);
+}
+
+static void RunCreateWorker(void *data) {
+	auto worker = (CreateWorker *) data;
+	for (auto i = 0u; i < worker->jobCount; ++i) {
+		RunCreateJob(worker->ctx->createJobs + worker->firstJob + i);
+	}
+}
+
+static void StartCreateJobs(ImguiBindings_Context *ctx, bool async) {
+	ctx->createJobs[CJ_VertexShader] =
+			{ctx, &CompileShaderJob, ShaderCompiler_ST_VertexShader, "ImguiBindings_VertexShader", VertexShader};
+	ctx->createJobs[CJ_FragmentShader] =
+			{ctx, &CompileShaderJob, ShaderCompiler_ST_FragmentShader, "ImguiBindings_FragmentShader", FragmentShader};
+	ctx->createJobs[CJ_FontAtlas] = {ctx, &BakeFontAtlasJob};
+
+	ctx->createWorkers[CW_Shaders] = {ctx, CJ_VertexShader, CJ_FontAtlas - CJ_VertexShader};
+	ctx->createWorkers[CW_FontAtlas] = {ctx, CJ_FontAtlas, 1};
+
+	ctx->createJobsRemaining = CJ_COUNT;
+	for (auto i = 0u; i < CW_COUNT; ++i) {
+		CreateWorker *worker = ctx->createWorkers + i;
+		worker->threaded = async && Thread_ThreadCreate(&worker->thread, &RunCreateWorker, worker);
+		if (!worker->threaded) {
+			RunCreateWorker(worker);
+		}
+	}
+}
+
+static void JoinCreateJobs(ImguiBindings_Context *ctx) {
+	for (auto i = 0u; i < CW_COUNT; ++i) {
+		CreateWorker *worker = ctx->createWorkers + i;
+		if (worker->threaded) {
+			Thread_ThreadJoin(&worker->thread);
+			Thread_ThreadDestroy(&worker->thread);
+			worker->threaded = false;
+		}
+	}
+	for (auto i = 0u; i < CJ_COUNT; ++i) {
+		FreeShaderOutput(&ctx->createJobs[i].output);
+	}
+}
+
+static bool CreateShaders(ImguiBindings_Context *ctx) {
+	ShaderCompiler_Output const *vout = &ctx->createJobs[CJ_VertexShader].output;
+	ShaderCompiler_Output const *fout = &ctx->createJobs[CJ_FragmentShader].output;
+
+	AddShader(ctx, "ImguiBindings_VertexShader", vout, "ImguiBindings_FragmentShader", fout, &ctx->shader);
+	return ctx->shader != nullptr;
 }
 
 static bool CreateFontTexture(ImguiBindings_Context *ctx) {
-	unsigned char *pixels;
-	int width, height;
-	ImGuiIO &io = ImGui::GetIO();
-	io.Fonts->AddFontDefault();
-	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
-	ctx->fontTexture.cpu = Image_CreateHeaderOnly(width, height, 1, 1, TinyImageFormat_R8G8B8A8_UNORM);
+	ctx->fontTexture.cpu = Image_CreateHeaderOnly(ctx->fontWidth, ctx->fontHeight, 1, 1, TinyImageFormat_R8G8B8A8_UNORM);
 
 	TheForge_RawImageData rawData{
-			pixels,
+			ctx->fontPixels,
 			TinyImageFormat_R8G8B8A8_UNORM,
-			(uint32_t) width,
-			(uint32_t) height,
+			(uint32_t) ctx->fontWidth,
+			(uint32_t) ctx->fontHeight,
 			1,
 			1,
 			1
@@ -182,16 +642,273 @@ static bool CreateFontTexture(ImguiBindings_Context *ctx) {
 		return false;
 	}
 
-	ImGui::GetIO().Fonts->TexID = (void *) &ctx->fontTexture;
+	ctx->fontAtlas->TexID = (void *) &ctx->fontTexture;
 
 	return true;
 }
 
+static bool SameTarget(ImguiBindings_TargetDesc const &a, ImguiBindings_TargetDesc const &b) {
+	return a.format == b.format && a.sampleCount == b.sampleCount && a.sampleQuality == b.sampleQuality;
+}
+
+static TheForge_PipelineHandle CreateVariantPipeline(ImguiBindings_Context *ctx,
+																										 ImguiBindings_TargetDesc const *target,
+																										 bool offscreen,
+																										 PipelineKind kind) {
+	static TheForge_VertexLayout const quadVertexLayout{
+			3,
+			{
+					{TheForge_SS_POSITION, 8, "POSITION", TinyImageFormat_R32G32B32A32_SFLOAT, 0, 0, 0, TheForge_VAR_INSTANCE},
+					{TheForge_SS_TEXCOORD0, 9, "TEXCOORD", TinyImageFormat_R16G16B16A16_UNORM, 0, 1, sizeof(float) * 4,
+					 TheForge_VAR_INSTANCE},
+					{TheForge_SS_COLOR, 5, "COLOR", TinyImageFormat_R8G8B8A8_UNORM, 0, 2, sizeof(float) * 4 + sizeof(uint16_t) * 4,
+					 TheForge_VAR_INSTANCE}
+			}
+	};
+	static TheForge_VertexLayout const clipVertexLayout{
+			4,
+			{
+					{TheForge_SS_POSITION, 8, "POSITION", TinyImageFormat_R32G32_SFLOAT, 0, 0, 0},
+					{TheForge_SS_TEXCOORD0, 9, "TEXCOORD", TinyImageFormat_R32G32_SFLOAT, 0, 1, sizeof(float) * 2},
+					{TheForge_SS_COLOR, 5, "COLOR", TinyImageFormat_R8G8B8A8_UNORM, 0, 2, sizeof(float) * 4},
+					// 32 bit, Metal needs vertex buffer strides to be a multiple of 4 bytes
+					{TheForge_SS_TEXCOORD1, 9, "CLIPINDEX", TinyImageFormat_R32_UINT, 1, 3, 0}
+			}
+	};
+
+	TinyImageFormat renderTargetFormat = target->format;
+
+	TheForge_PipelineDesc pipelineDesc{};
+	pipelineDesc.type = TheForge_PT_GRAPHICS;
+	TheForge_GraphicsPipelineDesc &gfxPipeDesc = pipelineDesc.graphicsDesc;
+	switch (kind) {
+		case PK_Triangles:
+			gfxPipeDesc.shaderProgram = ctx->shader;
+			gfxPipeDesc.pVertexLayout = ctx->vertexLayout;
+			break;
+		case PK_Quads:
+			gfxPipeDesc.shaderProgram = ctx->quadShader;
+			gfxPipeDesc.pVertexLayout = &quadVertexLayout;
+			break;
+		case PK_Clip:
+			gfxPipeDesc.shaderProgram = ctx->clipShader;
+			gfxPipeDesc.pVertexLayout = &clipVertexLayout;
+			break;
+	}
+	gfxPipeDesc.rootSignature = ctx->rootSignature;
+	gfxPipeDesc.blendState = offscreen ? ctx->offscreenBlendState : ctx->blendState;
+	gfxPipeDesc.depthState = nullptr;
+	gfxPipeDesc.rasterizerState = ctx->rasterizationState;
+	gfxPipeDesc.renderTargetCount = 1;
+	gfxPipeDesc.pColorFormats = &renderTargetFormat;
+	gfxPipeDesc.depthStencilFormat = TinyImageFormat_UNDEFINED;
+	gfxPipeDesc.sampleCount = target->sampleCount;
+	gfxPipeDesc.sampleQuality = target->sampleQuality;
+	gfxPipeDesc.primitiveTopo = TheForge_PT_TRI_LIST;
+
+	TheForge_PipelineHandle pipeline = nullptr;
+	TheForge_AddPipeline(ctx->renderer, &pipelineDesc, &pipeline);
+	return pipeline;
+}
+
+static PipelineVariant *FindPipelineVariant(ImguiBindings_Context *ctx,
+																						ImguiBindings_TargetDesc const *target,
+																						bool offscreen) {
+	uint32_t const count = Thread_AtomicLoad32Acquire(&ctx->pipelineVariantCount);
+	for (auto i = 0u; i < count; ++i) {
+		PipelineVariant *variant = ctx->pipelineVariants + i;
+		if (SameTarget(variant->target, *target) && variant->offscreen == offscreen) {
+			return variant;
+		}
+	}
+	return nullptr;
+}
+
+// variants are never removed before Destroy so the returned pointer stays valid.
+// offscreen variants accumulate premultiplied alpha for the MSAA target.
+// The pipeline is created outside the lock, if another thread got there first ours is thrown away
+static PipelineVariant *FindOrCreatePipelineVariant(ImguiBindings_Context *ctx,
+																										ImguiBindings_TargetDesc const *target,
+																										bool offscreen) {
+	PipelineVariant *found = FindPipelineVariant(ctx, target, offscreen);
+	if (found) {
+		return found;
+	}
+
+	TheForge_PipelineHandle pipeline = CreateVariantPipeline(ctx, target, offscreen, PK_Triangles);
+	if (!pipeline) {
+		return nullptr;
+	}
+
+	Thread_MutexAcquire(&ctx->pipelineMutex);
+	found = FindPipelineVariant(ctx, target, offscreen);
+	if (!found) {
+		uint32_t const count = Thread_AtomicLoad32Relaxed(&ctx->pipelineVariantCount);
+		if (count < MAX_PIPELINE_VARIANTS) {
+			found = ctx->pipelineVariants + count;
+			found->target = *target;
+			found->offscreen = offscreen;
+			found->pipeline = pipeline;
+			pipeline = nullptr;
+			Thread_AtomicStore32Release(&ctx->pipelineVariantCount, count + 1);
+		} else {
+			LOGERROR("ImguiBindings: more than %u render target variants", MAX_PIPELINE_VARIANTS);
+		}
+	}
+	Thread_MutexRelease(&ctx->pipelineMutex);
+
+	if (pipeline) {
+		TheForge_RemovePipeline(ctx->renderer, pipeline);
+	}
+	return found;
+}
+
+// the pipeline of a kind for a variant, creating the quad and clip ones on first use
+static TheForge_PipelineHandle VariantPipeline(ImguiBindings_Context *ctx, PipelineVariant *variant, PipelineKind kind) {
+	if (kind == PK_Triangles) {
+		return variant->pipeline;
+	}
+	TheForge_PipelineHandle *slot = (kind == PK_Quads) ? &variant->quadPipeline : &variant->clipPipeline;
+	uint32_t const bit = 1u << kind;
+	if (Thread_AtomicLoad32Acquire(&variant->readyMask) & bit) {
+		return *slot;
+	}
+
+	TheForge_PipelineHandle pipeline = CreateVariantPipeline(ctx, &variant->target, variant->offscreen, kind);
+	if (!pipeline) {
+		return nullptr;
+	}
+
+	Thread_MutexAcquire(&ctx->pipelineMutex);
+	uint32_t const readyMask = Thread_AtomicLoad32Relaxed(&variant->readyMask);
+	if (!(readyMask & bit)) {
+		*slot = pipeline;
+		pipeline = nullptr;
+		Thread_AtomicStore32Release(&variant->readyMask, readyMask | bit);
+	}
+	Thread_MutexRelease(&ctx->pipelineMutex);
+
+	if (pipeline) {
+		TheForge_RemovePipeline(ctx->renderer, pipeline);
+	}
+	return *slot;
+}
+
+static TheForge_PipelineHandle FindTargetPipeline(TargetPipeline const *pipelines,
+																								 Thread_Atomic32_t *count,
+																								 ImguiBindings_TargetDesc const *target) {
+	uint32_t const published = Thread_AtomicLoad32Acquire(count);
+	for (auto i = 0u; i < published; ++i) {
+		if (SameTarget(pipelines[i].target, *target)) {
+			return pipelines[i].pipeline;
+		}
+	}
+	return nullptr;
+}
+
+// adds a pipeline created outside the lock to a target pipeline cache, or throws it away if
+// another thread added one for the same target first
+static TheForge_PipelineHandle PublishTargetPipeline(ImguiBindings_Context *ctx,
+																										TargetPipeline *pipelines,
+																										Thread_Atomic32_t *count,
+																										ImguiBindings_TargetDesc const *target,
+																										TheForge_PipelineHandle pipeline) {
+	Thread_MutexAcquire(&ctx->pipelineMutex);
+	TheForge_PipelineHandle found = FindTargetPipeline(pipelines, count, target);
+	if (!found) {
+		uint32_t const published = Thread_AtomicLoad32Relaxed(count);
+		if (published < MAX_PIPELINE_VARIANTS) {
+			pipelines[published].target = *target;
+			pipelines[published].pipeline = pipeline;
+			found = pipeline;
+			pipeline = nullptr;
+			Thread_AtomicStore32Release(count, published + 1);
+		} else {
+			LOGERROR("ImguiBindings: more than %u targets for a mask or resolve pipeline", MAX_PIPELINE_VARIANTS);
+		}
+	}
+	Thread_MutexRelease(&ctx->pipelineMutex);
+
+	if (pipeline) {
+		TheForge_RemovePipeline(ctx->renderer, pipeline);
+	}
+	return found;
+}
+
+static TheForge_PipelineHandle FindOrCreateMaskPipeline(ImguiBindings_Context *ctx,
+																											 ImguiBindings_TargetDesc const *depthTarget) {
+	TheForge_PipelineHandle found = FindTargetPipeline(ctx->maskPipelineVariants, &ctx->maskPipelineVariantCount,
+																										 depthTarget);
+	if (found) {
+		return found;
+	}
+
+	static TheForge_VertexLayout const maskVertexLayout{
+			1,
+			{
+					{TheForge_SS_POSITION, 8, "POSITION", TinyImageFormat_R32G32B32_SFLOAT, 0, 0, 0},
+			}
+	};
+
+	TheForge_PipelineDesc pipelineDesc{};
+	pipelineDesc.type = TheForge_PT_GRAPHICS;
+	TheForge_GraphicsPipelineDesc &gfxPipeDesc = pipelineDesc.graphicsDesc;
+	gfxPipeDesc.shaderProgram = ctx->maskShader;
+	gfxPipeDesc.rootSignature = ctx->maskRootSignature;
+	gfxPipeDesc.pVertexLayout = &maskVertexLayout;
+	gfxPipeDesc.blendState = nullptr;
+	gfxPipeDesc.depthState = ctx->maskDepthState;
+	gfxPipeDesc.rasterizerState = ctx->rasterizationState;
+	gfxPipeDesc.renderTargetCount = 0;
+	gfxPipeDesc.pColorFormats = nullptr;
+	gfxPipeDesc.depthStencilFormat = depthTarget->format;
+	gfxPipeDesc.sampleCount = depthTarget->sampleCount;
+	gfxPipeDesc.sampleQuality = depthTarget->sampleQuality;
+	gfxPipeDesc.primitiveTopo = TheForge_PT_TRI_LIST;
+
+	TheForge_PipelineHandle pipeline = nullptr;
+	TheForge_AddPipeline(ctx->renderer, &pipelineDesc, &pipeline);
+	if (!pipeline) {
+		return nullptr;
+	}
+	return PublishTargetPipeline(ctx, ctx->maskPipelineVariants, &ctx->maskPipelineVariantCount, depthTarget, pipeline);
+}
+
+static TheForge_PipelineHandle FindOrCreateResolvePipeline(ImguiBindings_Context *ctx,
+																													ImguiBindings_TargetDesc const *target) {
+	TheForge_PipelineHandle found = FindTargetPipeline(ctx->resolvePipelines, &ctx->resolvePipelineCount, target);
+	if (found) {
+		return found;
+	}
+
+	TinyImageFormat renderTargetFormat = target->format;
+
+	TheForge_PipelineDesc pipelineDesc{};
+	pipelineDesc.type = TheForge_PT_GRAPHICS;
+	TheForge_GraphicsPipelineDesc &gfxPipeDesc = pipelineDesc.graphicsDesc;
+	gfxPipeDesc.shaderProgram = ctx->resolveShader;
+	gfxPipeDesc.rootSignature = ctx->resolveRootSignature;
+	gfxPipeDesc.pVertexLayout = nullptr;
+	gfxPipeDesc.blendState = ctx->resolveBlendState;
+	gfxPipeDesc.depthState = nullptr;
+	gfxPipeDesc.rasterizerState = ctx->rasterizationState;
+	gfxPipeDesc.renderTargetCount = 1;
+	gfxPipeDesc.pColorFormats = &renderTargetFormat;
+	gfxPipeDesc.depthStencilFormat = TinyImageFormat_UNDEFINED;
+	gfxPipeDesc.sampleCount = target->sampleCount;
+	gfxPipeDesc.sampleQuality = target->sampleQuality;
+	gfxPipeDesc.primitiveTopo = TheForge_PT_TRI_LIST;
+
+	TheForge_PipelineHandle pipeline = nullptr;
+	TheForge_AddPipeline(ctx->renderer, &pipelineDesc, &pipeline);
+	if (!pipeline) {
+		return nullptr;
+	}
+	return PublishTargetPipeline(ctx, ctx->resolvePipelines, &ctx->resolvePipelineCount, target, pipeline);
+}
+
 static bool CreateRenderThings(ImguiBindings_Context *ctx,
-															 ImguiBindings_Shared const *shared,
-															 TinyImageFormat renderTargetFormat,
-															 TheForge_SampleCount sampleCount,
-															 uint32_t sampleQuality) {
+															 ImguiBindings_Shared const *shared) {
 	if (!CreateShaders(ctx)) {
 		return false;
 	}
@@ -199,7 +916,6 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 		return false;
 	}
 
-	TheForge_VertexLayout const *vertexLayout = nullptr;
 	if (!shared) {
 		static TheForge_SamplerDesc const samplerDesc{
 				TheForge_FT_LINEAR,
@@ -245,14 +961,14 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 		TheForge_AddBlendState(ctx->renderer, &blendDesc, &ctx->blendState);
 		TheForge_AddDepthState(ctx->renderer, &depthStateDesc, &ctx->depthState);
 		TheForge_AddRasterizerState(ctx->renderer, &rasterizerStateDesc, &ctx->rasterizationState);
-		vertexLayout = &staticVertexLayout;
+		ctx->vertexLayout = &staticVertexLayout;
 		ctx->sharedState = false;
 	} else {
 		ctx->bilinearSampler = shared->bilinearSampler;
 		ctx->blendState = shared->porterDuffBlendState;
 		ctx->depthState = shared->ignoreDepthState;
 		ctx->rasterizationState = shared->solidNoCullRasterizerState;
-		vertexLayout = shared->twoD_PackedColour_UVVertexLayout;
+		ctx->vertexLayout = shared->twoD_PackedColour_UVVertexLayout;
 		ctx->sharedState = true;
 	}
 
@@ -269,7 +985,7 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 		return false;
 	}
 
-	static TheForge_BufferDesc const vbDesc{
+	TheForge_BufferDesc const vbDesc{
 			ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME * sizeof(ImDrawVert) * ctx->maxFrames,
 			TheForge_RMU_CPU_TO_GPU,
 			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT),
@@ -286,7 +1002,7 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 			TinyImageFormat_UNDEFINED,
 			TheForge_DESCRIPTOR_TYPE_VERTEX_BUFFER,
 	};
-	static TheForge_BufferDesc const ibDesc{
+	TheForge_BufferDesc const ibDesc{
 			ImguiBindings_MAX_INDEX_COUNT_PER_FRAME * sizeof(ImDrawIdx) * ctx->maxFrames,
 			TheForge_RMU_CPU_TO_GPU,
 			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT),
@@ -323,12 +1039,12 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 			TheForge_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
 	};
 
-	TheForge_ShaderHandle shaders[]{ctx->shader};
+	// the quad shader binds the same resources, so quad pipelines share this root signature and its sets
 	TheForge_SamplerHandle samplers[]{ctx->bilinearSampler};
 	char const *staticSamplerNames[]{"bilinearSampler"};
 	TheForge_RootSignatureDesc rootSignatureDesc{};
 	rootSignatureDesc.shaderCount = 1;
-	rootSignatureDesc.pShaders = shaders;
+	rootSignatureDesc.pShaders = &ctx->shader;
 	rootSignatureDesc.staticSamplerCount = 1;
 	rootSignatureDesc.pStaticSamplerNames = staticSamplerNames;
 	rootSignatureDesc.pStaticSamplers = samplers;
@@ -337,23 +1053,7 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 		return false;
 	}
 
-	TheForge_PipelineDesc pipelineDesc{};
-	pipelineDesc.type = TheForge_PT_GRAPHICS;
-	TheForge_GraphicsPipelineDesc &gfxPipeDesc = pipelineDesc.graphicsDesc;
-	gfxPipeDesc.shaderProgram = ctx->shader;
-	gfxPipeDesc.rootSignature = ctx->rootSignature;
-	gfxPipeDesc.pVertexLayout = vertexLayout;
-	gfxPipeDesc.blendState = ctx->blendState;
-	gfxPipeDesc.depthState = nullptr;
-	gfxPipeDesc.rasterizerState = ctx->rasterizationState;
-	gfxPipeDesc.renderTargetCount = 1;
-	gfxPipeDesc.pColorFormats = &renderTargetFormat;
-	gfxPipeDesc.depthStencilFormat = TinyImageFormat_UNDEFINED;
-	gfxPipeDesc.sampleCount = sampleCount;
-	gfxPipeDesc.sampleQuality = sampleQuality;
-	gfxPipeDesc.primitiveTopo = TheForge_PT_TRI_LIST;
-	TheForge_AddPipeline(ctx->renderer, &pipelineDesc, &ctx->pipeline);
-	if (!ctx->pipeline) {
+	if (!FindOrCreatePipelineVariant(ctx, &ctx->defaultTarget, false)) {
 		return false;
 	}
 
@@ -367,10 +1067,12 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 		return false;
 	}
 
+	// uniforms are per render call, each frame has a slot for every call it can make
+	uint32_t const callSlotCount = ctx->maxFrames * ImguiBindings_MAX_RENDER_CALLS_PER_FRAME;
 	TheForge_DescriptorSetDesc const setDescUniform = {
 			ctx->rootSignature,
 			TheForge_DESCRIPTOR_UPDATE_FREQ_NONE,
-			ctx->maxFrames
+			callSlotCount
 	};
 
 	TheForge_AddDescriptorSet(ctx->renderer, &setDescUniform, &ctx->descriptorSetUniform);
@@ -386,12 +1088,12 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 	if (!ctx->indexBuffer) {
 		return false;
 	}
-	ctx->uniformBuffers = (TheForge_BufferHandle *) MEMORY_MALLOC(sizeof(TheForge_BufferHandle) * ctx->maxFrames);
+	ctx->uniformBuffers = (TheForge_BufferHandle *) MEMORY_CALLOC(callSlotCount, sizeof(TheForge_BufferHandle));
 	if (!ctx->uniformBuffers) {
 		return false;
 	}
 
-	for (auto i = 0u; i < ctx->maxFrames; ++i) {
+	for (auto i = 0u; i < callSlotCount; ++i) {
 		TheForge_AddBuffer(ctx->renderer, &ubDesc, ctx->uniformBuffers + i);
 		if (!ctx->uniformBuffers[i]) {
 			return false;
@@ -412,28 +1114,353 @@ static bool CreateRenderThings(ImguiBindings_Context *ctx,
 	return true;
 }
 
-static void DestroyRenderThings(ImguiBindings_Context *ctx) {
-	if (ctx->fontTexture.gpu) {
-		TheForge_RemoveTexture(ctx->renderer, ctx->fontTexture.gpu);
-	}
-	if (ctx->fontTexture.cpu) {
-		Image_Destroy(ctx->fontTexture.cpu);
-	}
-
-	if (ctx->uniformBuffers) {
-		for (auto i = 0u; i < ctx->maxFrames; ++i) {
-			if (ctx->uniformBuffers[i]) {
-				TheForge_RemoveBuffer(ctx->renderer, ctx->uniformBuffers[i]);
-			}
-		}
-		MEMORY_FREE(ctx->uniformBuffers);
+static bool SetupQuadExpansion(ImguiBindings_Context *ctx) {
+	if (!CompileAndAddShader(ctx, "ImguiBindings_QuadVertexShader", QuadVertexShader,
+													 "ImguiBindings_FragmentShader", FragmentShader, &ctx->quadShader)) {
+		return false;
 	}
 
-	if (ctx->vertexBuffer) {
-		TheForge_RemoveBuffer(ctx->renderer, ctx->vertexBuffer);
-	}
-	if (ctx->indexBuffer) {
-		TheForge_RemoveBuffer(ctx->renderer, ctx->indexBuffer);
+	TheForge_BufferDesc const qbDesc{
+			ImguiBindings_MAX_QUAD_COUNT_PER_FRAME * sizeof(QuadInstance) * ctx->maxFrames,
+			TheForge_RMU_CPU_TO_GPU,
+			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT),
+			TheForge_RS_UNDEFINED,
+			TheForge_IT_UINT16,
+			sizeof(QuadInstance),
+			0,
+			0,
+			0,
+			TheForge_IAT_DRAW,
+			0,
+			0,
+			nullptr,
+			TinyImageFormat_UNDEFINED,
+			TheForge_DESCRIPTOR_TYPE_VERTEX_BUFFER,
+	};
+	TheForge_AddBuffer(ctx->renderer, &qbDesc, &ctx->quadBuffer);
+	return ctx->quadBuffer != nullptr;
+}
+
+static bool SetupShaderClipping(ImguiBindings_Context *ctx) {
+	if (!CompileAndAddShader(ctx, "ImguiBindings_ClipVertexShader", ClipVertexShader,
+													 "ImguiBindings_ClipFragmentShader", ClipFragmentShader, &ctx->clipShader)) {
+		return false;
+	}
+
+	TheForge_SamplerHandle samplers[]{ctx->bilinearSampler};
+	char const *staticSamplerNames[]{"bilinearSampler"};
+	TheForge_RootSignatureDesc rootSignatureDesc{};
+	rootSignatureDesc.shaderCount = 1;
+	rootSignatureDesc.pShaders = &ctx->clipShader;
+	rootSignatureDesc.staticSamplerCount = 1;
+	rootSignatureDesc.pStaticSamplerNames = staticSamplerNames;
+	rootSignatureDesc.pStaticSamplers = samplers;
+	TheForge_AddRootSignature(ctx->renderer, &rootSignatureDesc, &ctx->clipRootSignature);
+	if (!ctx->clipRootSignature) {
+		return false;
+	}
+
+	TheForge_DescriptorSetDesc const setDescTexture = {
+			ctx->clipRootSignature,
+			TheForge_DESCRIPTOR_UPDATE_FREQ_PER_BATCH,
+			(ctx->maxTextureChangesPerFrame * ctx->maxFrames)
+	};
+	TheForge_AddDescriptorSet(ctx->renderer, &setDescTexture, &ctx->clipDescriptorSetTexture);
+	if (!ctx->clipDescriptorSetTexture) {
+		return false;
+	}
+
+	// the clip table sits next to the uniforms in each render call's slot
+	uint32_t const callSlotCount = ctx->maxFrames * ImguiBindings_MAX_RENDER_CALLS_PER_FRAME;
+	TheForge_DescriptorSetDesc const setDescUniform = {
+			ctx->clipRootSignature,
+			TheForge_DESCRIPTOR_UPDATE_FREQ_NONE,
+			callSlotCount
+	};
+	TheForge_AddDescriptorSet(ctx->renderer, &setDescUniform, &ctx->clipDescriptorSetUniform);
+	if (!ctx->clipDescriptorSetUniform) {
+		return false;
+	}
+
+	ctx->clipTableBuffers = (TheForge_BufferHandle *) MEMORY_CALLOC(callSlotCount, sizeof(TheForge_BufferHandle));
+	if (!ctx->clipTableBuffers) {
+		return false;
+	}
+
+	static TheForge_BufferDesc const clipTableDesc{
+			MAX_CLIP_RECTS_PER_FRAME * sizeof(float) * 4,
+			TheForge_RMU_CPU_TO_GPU,
+			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT |
+					TheForge_BCF_NO_DESCRIPTOR_VIEW_CREATION),
+			TheForge_RS_UNDEFINED,
+			TheForge_IT_UINT16,
+			0,
+			0,
+			0,
+			0,
+			TheForge_IAT_DRAW,
+			0,
+			0,
+			nullptr,
+			TinyImageFormat_UNDEFINED,
+			TheForge_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+	};
+
+	for (auto i = 0u; i < callSlotCount; ++i) {
+		TheForge_AddBuffer(ctx->renderer, &clipTableDesc, ctx->clipTableBuffers + i);
+		if (!ctx->clipTableBuffers[i]) {
+			return false;
+		}
+
+		uint64_t const offsets[] = {0};
+		uint64_t const sizes[] = {UNIFORM_BUFFER_SIZE_PER_FRAME};
+		uint64_t const clipTableSizes[] = {clipTableDesc.size};
+
+		TheForge_DescriptorData descData[2]{{"uniformBlockVS"}, {"clipTableVS"}};
+		descData[0].index = ~0;
+		descData[0].pBuffers = ctx->uniformBuffers + i;
+		descData[0].count = 1;
+		descData[0].pOffsets = offsets;
+		descData[0].pSizes = sizes;
+		descData[1].index = ~0;
+		descData[1].pBuffers = ctx->clipTableBuffers + i;
+		descData[1].count = 1;
+		descData[1].pOffsets = offsets;
+		descData[1].pSizes = clipTableSizes;
+		TheForge_UpdateDescriptorSet(ctx->renderer, i, ctx->clipDescriptorSetUniform, 2, descData);
+	}
+
+	ctx->clipTableStaging = (float *) MEMORY_MALLOC(sizeof(float) * 4 * MAX_CLIP_RECTS_PER_FRAME);
+	ctx->clipIndexStaging = (uint32_t *) MEMORY_MALLOC(sizeof(uint32_t) * ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME);
+	if (!ctx->clipTableStaging || !ctx->clipIndexStaging) {
+		return false;
+	}
+
+	TheForge_BufferDesc const cibDesc{
+			ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME * sizeof(uint32_t) * ctx->maxFrames,
+			TheForge_RMU_CPU_TO_GPU,
+			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT),
+			TheForge_RS_UNDEFINED,
+			TheForge_IT_UINT16,
+			sizeof(uint32_t),
+			0,
+			0,
+			0,
+			TheForge_IAT_DRAW,
+			0,
+			0,
+			nullptr,
+			TinyImageFormat_UNDEFINED,
+			TheForge_DESCRIPTOR_TYPE_VERTEX_BUFFER,
+	};
+	TheForge_AddBuffer(ctx->renderer, &cibDesc, &ctx->clipIndexBuffer);
+	return ctx->clipIndexBuffer != nullptr;
+}
+
+static bool SetupOpaqueMask(ImguiBindings_Context *ctx) {
+	if (!CompileAndAddShader(ctx, "ImguiBindings_MaskVertexShader", MaskVertexShader,
+													 "ImguiBindings_MaskFragmentShader", MaskFragmentShader, &ctx->maskShader)) {
+		return false;
+	}
+
+	TheForge_RootSignatureDesc maskRootSignatureDesc{};
+	maskRootSignatureDesc.shaderCount = 1;
+	maskRootSignatureDesc.pShaders = &ctx->maskShader;
+	TheForge_AddRootSignature(ctx->renderer, &maskRootSignatureDesc, &ctx->maskRootSignature);
+	if (!ctx->maskRootSignature) {
+		return false;
+	}
+
+	static TheForge_DepthStateDesc const maskDepthStateDesc{
+			true, true,
+			TheForge_CMP_ALWAYS,
+	};
+	TheForge_AddDepthState(ctx->renderer, &maskDepthStateDesc, &ctx->maskDepthState);
+	if (!ctx->maskDepthState) {
+		return false;
+	}
+
+	TheForge_BufferDesc const maskVbDesc{
+			ImguiBindings_MAX_OPAQUE_RECTS * MASK_VERTICES_PER_RECT * MASK_VERTEX_SIZE * ctx->maxFrames,
+			TheForge_RMU_CPU_TO_GPU,
+			(TheForge_BufferCreationFlags) (TheForge_BCF_PERSISTENT_MAP_BIT),
+			TheForge_RS_UNDEFINED,
+			TheForge_IT_UINT16,
+			MASK_VERTEX_SIZE,
+			0,
+			0,
+			0,
+			TheForge_IAT_DRAW,
+			0,
+			0,
+			nullptr,
+			TinyImageFormat_UNDEFINED,
+			TheForge_DESCRIPTOR_TYPE_VERTEX_BUFFER,
+	};
+	TheForge_AddBuffer(ctx->renderer, &maskVbDesc, &ctx->maskVertexBuffer);
+	return ctx->maskVertexBuffer != nullptr;
+}
+
+static bool SetupMSAA(ImguiBindings_Context *ctx) {
+	if (!CompileAndAddShader(ctx, "ImguiBindings_ResolveVertexShader", ResolveVertexShader,
+													 "ImguiBindings_ResolveFragmentShader", ResolveFragmentShader, &ctx->resolveShader)) {
+		return false;
+	}
+
+	// MSAA mode clears its target to transparent, so alpha has to accumulate for the resolve
+	// to composite premultiplied colour over the caller's target
+	static TheForge_BlendStateDesc const offscreenBlendDesc{
+			{TheForge_BC_SRC_ALPHA},
+			{TheForge_BC_ONE_MINUS_SRC_ALPHA},
+			{TheForge_BC_ONE},
+			{TheForge_BC_ONE_MINUS_SRC_ALPHA},
+			{TheForge_BM_ADD},
+			{TheForge_BM_ADD},
+			{0xF},
+			TheForge_BST_0,
+			false, false
+	};
+	static TheForge_BlendStateDesc const resolveBlendDesc{
+			{TheForge_BC_ONE},
+			{TheForge_BC_ONE_MINUS_SRC_ALPHA},
+			{TheForge_BC_ONE},
+			{TheForge_BC_ONE_MINUS_SRC_ALPHA},
+			{TheForge_BM_ADD},
+			{TheForge_BM_ADD},
+			{0xF},
+			TheForge_BST_0,
+			false, false
+	};
+	TheForge_AddBlendState(ctx->renderer, &offscreenBlendDesc, &ctx->offscreenBlendState);
+	TheForge_AddBlendState(ctx->renderer, &resolveBlendDesc, &ctx->resolveBlendState);
+	if (!ctx->offscreenBlendState || !ctx->resolveBlendState) {
+		return false;
+	}
+
+	TheForge_RootSignatureDesc resolveRootSignatureDesc{};
+	resolveRootSignatureDesc.shaderCount = 1;
+	resolveRootSignatureDesc.pShaders = &ctx->resolveShader;
+	TheForge_AddRootSignature(ctx->renderer, &resolveRootSignatureDesc, &ctx->resolveRootSignature);
+	if (!ctx->resolveRootSignature) {
+		return false;
+	}
+
+	// a set per render call slot, so one in flight isn't rewritten when the MSAA target changes
+	TheForge_DescriptorSetDesc const setDescResolve{
+			ctx->resolveRootSignature,
+			TheForge_DESCRIPTOR_UPDATE_FREQ_NONE,
+			ctx->maxFrames * ImguiBindings_MAX_RENDER_CALLS_PER_FRAME
+	};
+	TheForge_AddDescriptorSet(ctx->renderer, &setDescResolve, &ctx->resolveDescriptorSet);
+	return ctx->resolveDescriptorSet != nullptr;
+}
+
+// replaces the context's empty default atlas with the one the worker baked
+static void InstallFontAtlas(ImguiBindings_Context *ctx) {
+	ImGuiContext *previous = ImGui::GetCurrentContext();
+	ImGui::SetCurrentContext(ctx->context);
+	ImGuiIO &io = ImGui::GetIO();
+	IM_DELETE(io.Fonts);
+	io.Fonts = ctx->fontAtlas;
+	ctx->fontAtlasInstalled = true;
+	ImGui::SetCurrentContext(previous);
+}
+
+// the gpu side of creation runs on whichever thread first sees the cpu jobs are finished, which
+// holds createMutex meanwhile. Once finished, callers don't lock at all
+static ImguiBindings_CreateStatus UpdateCreateStatus(ImguiBindings_Context *ctx) {
+	if (Thread_AtomicLoad32Acquire(&ctx->createFinished)) {
+		return ctx->createStatus;
+	}
+
+	Thread_MutexAcquire(&ctx->createMutex);
+	if (ctx->createStatus == ImguiBindings_CS_Pending && ctx->createJobsRemaining == 0) {
+		bool const okay = !ctx->createJobFailed && CreateRenderThings(ctx, ctx->hasShared ? &ctx->shared : nullptr);
+		JoinCreateJobs(ctx);
+		if (okay) {
+			InstallFontAtlas(ctx);
+		}
+		ctx->createStatus = okay ? ImguiBindings_CS_Ready : ImguiBindings_CS_Failed;
+		Thread_AtomicStore32Release(&ctx->createFinished, 1);
+	}
+	ImguiBindings_CreateStatus const status = ctx->createStatus;
+	Thread_MutexRelease(&ctx->createMutex);
+
+	return status;
+}
+
+// sets a mode up the first time it's needed and reports whether it can be used. Only runs once
+// creation has finished, so the shader compiler is never used by a create worker meanwhile
+static bool SetupMode(ImguiBindings_Context *ctx, Modes mode) {
+	static char const *const modeNames[MD_COUNT]{"quad expansion", "shader clipping", "opaque mask", "MSAA"};
+	static bool (*const setups[MD_COUNT])(ImguiBindings_Context *){
+			&SetupQuadExpansion, &SetupShaderClipping, &SetupOpaqueMask, &SetupMSAA
+	};
+
+	uint32_t state = Thread_AtomicLoad32Acquire(&ctx->modeSetup[mode]);
+	if (state != MS_NotSetUp) {
+		return state == MS_Ready;
+	}
+	if (UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
+		return false;
+	}
+
+	Thread_MutexAcquire(&ctx->createMutex);
+	state = Thread_AtomicLoad32Relaxed(&ctx->modeSetup[mode]);
+	if (state == MS_NotSetUp) {
+		state = setups[mode](ctx) ? MS_Ready : MS_Failed;
+		if (state == MS_Failed) {
+			LOGERROR("ImguiBindings: %s couldn't be set up and stays off", modeNames[mode]);
+		}
+		Thread_AtomicStore32Release(&ctx->modeSetup[mode], state);
+	}
+	Thread_MutexRelease(&ctx->createMutex);
+
+	return state == MS_Ready;
+}
+
+static void DestroyRenderThings(ImguiBindings_Context *ctx) {
+	if (ctx->fontTexture.gpu) {
+		TheForge_RemoveTexture(ctx->renderer, ctx->fontTexture.gpu);
+	}
+	if (ctx->fontTexture.cpu) {
+		Image_Destroy(ctx->fontTexture.cpu);
+	}
+
+	uint32_t const callSlotCount = ctx->maxFrames * ImguiBindings_MAX_RENDER_CALLS_PER_FRAME;
+	if (ctx->uniformBuffers) {
+		for (auto i = 0u; i < callSlotCount; ++i) {
+			if (ctx->uniformBuffers[i]) {
+				TheForge_RemoveBuffer(ctx->renderer, ctx->uniformBuffers[i]);
+			}
+		}
+		MEMORY_FREE(ctx->uniformBuffers);
+	}
+	if (ctx->clipTableBuffers) {
+		for (auto i = 0u; i < callSlotCount; ++i) {
+			if (ctx->clipTableBuffers[i]) {
+				TheForge_RemoveBuffer(ctx->renderer, ctx->clipTableBuffers[i]);
+			}
+		}
+		MEMORY_FREE(ctx->clipTableBuffers);
+	}
+	if (ctx->clipIndexBuffer) {
+		TheForge_RemoveBuffer(ctx->renderer, ctx->clipIndexBuffer);
+	}
+	MEMORY_FREE(ctx->clipTableStaging);
+	MEMORY_FREE(ctx->clipIndexStaging);
+	if (ctx->clipDescriptorSetTexture) {
+		TheForge_RemoveDescriptorSet(ctx->renderer, ctx->clipDescriptorSetTexture);
+	}
+	if (ctx->clipDescriptorSetUniform) {
+		TheForge_RemoveDescriptorSet(ctx->renderer, ctx->clipDescriptorSetUniform);
+	}
+
+	if (ctx->vertexBuffer) {
+		TheForge_RemoveBuffer(ctx->renderer, ctx->vertexBuffer);
+	}
+	if (ctx->indexBuffer) {
+		TheForge_RemoveBuffer(ctx->renderer, ctx->indexBuffer);
 	}
 	if (ctx->descriptorSetTexture) {
 		TheForge_RemoveDescriptorSet(ctx->renderer, ctx->descriptorSetTexture);
@@ -442,8 +1469,61 @@ static void DestroyRenderThings(ImguiBindings_Context *ctx) {
 		TheForge_RemoveDescriptorSet(ctx->renderer, ctx->descriptorSetUniform);
 	}
 
-	if (ctx->pipeline) {
-		TheForge_RemovePipeline(ctx->renderer, ctx->pipeline);
+	if (ctx->quadBuffer) {
+		TheForge_RemoveBuffer(ctx->renderer, ctx->quadBuffer);
+	}
+	MEMORY_FREE(ctx->quadRuns);
+
+	if (ctx->msaaTarget) {
+		TheForge_RemoveRenderTarget(ctx->renderer, ctx->msaaTarget);
+	}
+	for (auto i = 0u; i < ctx->retiredMsaaTargetCount; ++i) {
+		TheForge_RemoveRenderTarget(ctx->renderer, ctx->retiredMsaaTargets[i].target);
+	}
+	uint32_t const resolvePipelineCount = Thread_AtomicLoad32Relaxed(&ctx->resolvePipelineCount);
+	for (auto i = 0u; i < resolvePipelineCount; ++i) {
+		TheForge_RemovePipeline(ctx->renderer, ctx->resolvePipelines[i].pipeline);
+	}
+	if (ctx->resolveDescriptorSet) {
+		TheForge_RemoveDescriptorSet(ctx->renderer, ctx->resolveDescriptorSet);
+	}
+	if (ctx->resolveRootSignature) {
+		TheForge_RemoveRootSignature(ctx->renderer, ctx->resolveRootSignature);
+	}
+	if (ctx->resolveBlendState) {
+		TheForge_RemoveBlendState(ctx->renderer, ctx->resolveBlendState);
+	}
+	if (ctx->offscreenBlendState) {
+		TheForge_RemoveBlendState(ctx->renderer, ctx->offscreenBlendState);
+	}
+
+	uint32_t const maskPipelineCount = Thread_AtomicLoad32Relaxed(&ctx->maskPipelineVariantCount);
+	for (auto i = 0u; i < maskPipelineCount; ++i) {
+		TheForge_RemovePipeline(ctx->renderer, ctx->maskPipelineVariants[i].pipeline);
+	}
+	if (ctx->maskVertexBuffer) {
+		TheForge_RemoveBuffer(ctx->renderer, ctx->maskVertexBuffer);
+	}
+	if (ctx->maskDepthState) {
+		TheForge_RemoveDepthState(ctx->renderer, ctx->maskDepthState);
+	}
+	if (ctx->maskRootSignature) {
+		TheForge_RemoveRootSignature(ctx->renderer, ctx->maskRootSignature);
+	}
+
+	uint32_t const pipelineVariantCount = Thread_AtomicLoad32Relaxed(&ctx->pipelineVariantCount);
+	for (auto i = 0u; i < pipelineVariantCount; ++i) {
+		PipelineVariant const &variant = ctx->pipelineVariants[i];
+		if (variant.clipPipeline) {
+			TheForge_RemovePipeline(ctx->renderer, variant.clipPipeline);
+		}
+		if (variant.quadPipeline) {
+			TheForge_RemovePipeline(ctx->renderer, variant.quadPipeline);
+		}
+		TheForge_RemovePipeline(ctx->renderer, variant.pipeline);
+	}
+	if (ctx->clipRootSignature) {
+		TheForge_RemoveRootSignature(ctx->renderer, ctx->clipRootSignature);
 	}
 	if (ctx->rootSignature) {
 		TheForge_RemoveRootSignature(ctx->renderer, ctx->rootSignature);
@@ -464,6 +1544,18 @@ static void DestroyRenderThings(ImguiBindings_Context *ctx) {
 		}
 	}
 
+	if (ctx->resolveShader) {
+		TheForge_RemoveShader(ctx->renderer, ctx->resolveShader);
+	}
+	if (ctx->maskShader) {
+		TheForge_RemoveShader(ctx->renderer, ctx->maskShader);
+	}
+	if (ctx->clipShader) {
+		TheForge_RemoveShader(ctx->renderer, ctx->clipShader);
+	}
+	if (ctx->quadShader) {
+		TheForge_RemoveShader(ctx->renderer, ctx->quadShader);
+	}
 	if (ctx->shader) {
 		TheForge_RemoveShader(ctx->renderer, ctx->shader);
 	}
@@ -477,31 +1569,57 @@ static void free_func(void *ptr, void *user_data) {
 	MEMORY_FREE(ptr);
 }
 
-AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_Create(TheForge_RendererHandle renderer,
-																																ShaderCompiler_ContextHandle shaderCompiler,
-																																InputBasic_ContextHandle input,
-																																ImguiBindings_Shared const *shared,
-																																uint32_t maxDynamicUIUpdatesPerBatch,
-																																uint32_t maxFrames,
-																																TinyImageFormat renderTargetFormat,
-																																TheForge_SampleCount sampleCount,
-																																uint32_t sampleQuality) {
+static ImguiBindings_Context *CreateContext(TheForge_RendererHandle renderer,
+																					 ShaderCompiler_ContextHandle shaderCompiler,
+																					 InputBasic_ContextHandle input,
+																					 ImguiBindings_Shared const *shared,
+																					 uint32_t maxDynamicUIUpdatesPerBatch,
+																					 uint32_t maxFrames,
+																					 TinyImageFormat renderTargetFormat,
+																					 TheForge_SampleCount sampleCount,
+																					 uint32_t sampleQuality,
+																					 bool async) {
 	auto ctx = (ImguiBindings_Context *) MEMORY_CALLOC(1, sizeof(ImguiBindings_Context));
 	if (!ctx) {
 		return nullptr;
 	}
 
+	bool const snapshotMutex = Thread_MutexCreate(&ctx->snapshotMutex);
+	bool const pipelineMutex = Thread_MutexCreate(&ctx->pipelineMutex);
+	bool const createMutex = Thread_MutexCreate(&ctx->createMutex);
+	if (!snapshotMutex || !pipelineMutex || !createMutex) {
+		if (snapshotMutex) {
+			Thread_MutexDestroy(&ctx->snapshotMutex);
+		}
+		if (pipelineMutex) {
+			Thread_MutexDestroy(&ctx->pipelineMutex);
+		}
+		if (createMutex) {
+			Thread_MutexDestroy(&ctx->createMutex);
+		}
+		MEMORY_FREE(ctx);
+		return nullptr;
+	}
+
 	ctx->renderer = renderer;
 	ctx->shaderCompiler = shaderCompiler;
 	ctx->input = input;
 	ctx->maxTextureChangesPerFrame = maxDynamicUIUpdatesPerBatch;
 	ctx->maxFrames = maxFrames;
+	ctx->defaultTarget = {renderTargetFormat, sampleCount, sampleQuality};
+	Thread_AtomicStore32Relaxed(&ctx->msaaSampleCount, TheForge_SC_1);
+	if (shared) {
+		ctx->shared = *shared;
+		ctx->hasShared = true;
+	}
 
 	ImGui::SetAllocatorFunctions(alloc_func, free_func, nullptr);
 	ctx->context = ImGui::CreateContext();
 	ImGui::SetCurrentContext(ctx->context);
+	ctx->fontAtlas = IM_NEW(ImFontAtlas)();
 
-	if (!CreateRenderThings(ctx, shared, renderTargetFormat, sampleCount, sampleQuality)) {
+	StartCreateJobs(ctx, async);
+	if (!async && UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
 		ImguiBindings_Destroy(ctx);
 		return nullptr;
 	}
@@ -532,14 +1650,61 @@ AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_Create(TheForge_Rendere
 	return ctx;
 }
 
+AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_Create(TheForge_RendererHandle renderer,
+																																ShaderCompiler_ContextHandle shaderCompiler,
+																																InputBasic_ContextHandle input,
+																																ImguiBindings_Shared const *shared,
+																																uint32_t maxDynamicUIUpdatesPerBatch,
+																																uint32_t maxFrames,
+																																TinyImageFormat renderTargetFormat,
+																																TheForge_SampleCount sampleCount,
+																																uint32_t sampleQuality) {
+	return CreateContext(renderer, shaderCompiler, input, shared,
+											 maxDynamicUIUpdatesPerBatch, maxFrames,
+											 renderTargetFormat, sampleCount, sampleQuality,
+											 false);
+}
+
+AL2O3_EXTERN_C ImguiBindings_ContextHandle ImguiBindings_CreateAsync(TheForge_RendererHandle renderer,
+																																		 ShaderCompiler_ContextHandle shaderCompiler,
+																																		 InputBasic_ContextHandle input,
+																																		 ImguiBindings_Shared const *shared,
+																																		 uint32_t maxDynamicUIUpdatesPerBatch,
+																																		 uint32_t maxFrames,
+																																		 TinyImageFormat renderTargetFormat,
+																																		 TheForge_SampleCount sampleCount,
+																																		 uint32_t sampleQuality) {
+	return CreateContext(renderer, shaderCompiler, input, shared,
+											 maxDynamicUIUpdatesPerBatch, maxFrames,
+											 renderTargetFormat, sampleCount, sampleQuality,
+											 true);
+}
+
+AL2O3_EXTERN_C ImguiBindings_CreateStatus ImguiBindings_GetCreateStatus(ImguiBindings_ContextHandle handle) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return ImguiBindings_CS_Failed;
+	}
+
+	return UpdateCreateStatus(ctx);
+}
+
 AL2O3_EXTERN_C void ImguiBindings_Destroy(ImguiBindings_ContextHandle handle) {
 	auto ctx = (ImguiBindings_Context *) handle;
 	if (!ctx) {
 		return;
 	}
 
+	// the workers may still be using the font atlas and shader compiler
+	JoinCreateJobs(ctx);
+
 	InputBasic_MouseDestroy(ctx->mouse);
 
+	// once installed the context owns it
+	if (!ctx->fontAtlasInstalled) {
+		IM_DELETE(ctx->fontAtlas);
+	}
+	ctx->fontAtlas = nullptr;
 	if (ctx->context) {
 		ImGui::DestroyContext(ctx->context);
 	}
@@ -547,6 +1712,20 @@ AL2O3_EXTERN_C void ImguiBindings_Destroy(ImguiBindings_ContextHandle handle) {
 
 	DestroyRenderThings(ctx);
 
+	while (ctx->freeSnapshots) {
+		ImguiBindings_DrawDataSnapshot *snapshot = ctx->freeSnapshots;
+		ctx->freeSnapshots = snapshot->nextFree;
+		MEMORY_FREE(snapshot->lists);
+		MEMORY_FREE(snapshot->cmds);
+		MEMORY_FREE(snapshot->indices);
+		MEMORY_FREE(snapshot->vertices);
+		MEMORY_FREE(snapshot);
+	}
+	Thread_MutexDestroy(&ctx->snapshotMutex);
+	Thread_MutexDestroy(&ctx->pipelineMutex);
+	Thread_MutexDestroy(&ctx->createMutex);
+
+	MEMORY_FREE(ctx->liveLists);
 	MEMORY_FREE(ctx);
 }
 
@@ -581,57 +1760,567 @@ AL2O3_EXTERN_C bool ImguiBindings_UpdateInput(ImguiBindings_ContextHandle handle
 	return io.WantCaptureMouse;
 }
 
-AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle, TheForge_CmdHandle cmd) {
+AL2O3_EXTERN_C bool ImguiBindings_SetQuadExpansion(ImguiBindings_ContextHandle handle, bool enable) {
 	auto ctx = (ImguiBindings_Context *) handle;
 	if (!ctx) {
-		return 0;
+		return false;
 	}
 
-	ImDrawData *drawData = ImGui::GetDrawData();
+	if (enable && !SetupMode(ctx, MD_QuadExpansion)) {
+		return false;
+	}
 
-	// Copy and convert all vertices into a single contiguous buffer
-	uint64_t const baseVertexOffset = ctx->currentFrame * ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME;
-	uint64_t const baseIndexOffset = ctx->currentFrame * ImguiBindings_MAX_INDEX_COUNT_PER_FRAME;
+	Thread_AtomicStore32Release(&ctx->quadExpansion, enable);
+	return true;
+}
 
-	uint32_t vertexCount = 0;
-	uint32_t indexCount = 0;
-	for (int n = 0; n < drawData->CmdListsCount; n++) {
-		// gather lists into single contigious buffers
-		ImDrawList const *cmdList = drawData->CmdLists[n];
+static uint32_t FloatBits(float f) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
 
-		TheForge_BufferUpdateDesc const vertexUpdate{
-				ctx->vertexBuffer,
-				cmdList->VtxBuffer.Data,
-				0,
+// matches the vertex/index pattern ImDrawList::PrimRectUV emits (used for text and filled rects).
+// The vertex tests compare bits without branching, most candidates pass them all
+static bool IsAxisAlignedQuad(ImDrawVert const *vtx, ImDrawIdx const *idx) {
+	uint32_t const i0 = idx[0];
+	if (idx[1] != i0 + 1 || idx[2] != i0 + 2 || idx[3] != i0 || idx[4] != i0 + 2 || idx[5] != i0 + 3) {
+		return false;
+	}
+	ImDrawVert const &a = vtx[i0 + 0];
+	ImDrawVert const &b = vtx[i0 + 1];
+	ImDrawVert const &c = vtx[i0 + 2];
+	ImDrawVert const &d = vtx[i0 + 3];
+	uint32_t const diff = (a.col ^ b.col) | (a.col ^ c.col) | (a.col ^ d.col) |
+			(FloatBits(a.pos.y) ^ FloatBits(b.pos.y)) | (FloatBits(b.pos.x) ^ FloatBits(c.pos.x)) |
+			(FloatBits(c.pos.y) ^ FloatBits(d.pos.y)) | (FloatBits(d.pos.x) ^ FloatBits(a.pos.x)) |
+			(FloatBits(a.uv.y) ^ FloatBits(b.uv.y)) | (FloatBits(b.uv.x) ^ FloatBits(c.uv.x)) |
+			(FloatBits(c.uv.y) ^ FloatBits(d.uv.y)) | (FloatBits(d.uv.x) ^ FloatBits(a.uv.x));
+	// uvs are packed as unorm16, wrapping/tiling uvs take the triangle path. As unsigned bits
+	// 0 <= uv <= 1 is a single compare, negatives and NaNs have larger bits than 1.0f
+	uint32_t const one = FloatBits(1.0f);
+	bool const unorm = (FloatBits(a.uv.x) <= one) & (FloatBits(a.uv.y) <= one) &
+			(FloatBits(c.uv.x) <= one) & (FloatBits(c.uv.y) <= one);
+	return (diff == 0) & unorm;
+}
+
+// f must be in [0,1], adding 2^23 leaves the rounded f * 65535 in the low mantissa bits
+static uint16_t PackUnorm16(float f) {
+	return (uint16_t) FloatBits(f * 65535.0f + 8388608.0f);
+}
+
+// true if box continues the line of text in line (overlaps it vertically, starts just after it)
+static bool ExtendsLine(OverlapBox const &line, OverlapBox const &box) {
+	return box.y0 < line.y1 && box.y1 > line.y0 && box.x0 >= line.x0 && box.x0 <= line.x1 + (line.y1 - line.y0);
+}
+
+static void MergeBox(OverlapBox &dst, OverlapBox const &box) {
+	dst.x0 = box.x0 < dst.x0 ? box.x0 : dst.x0;
+	dst.y0 = box.y0 < dst.y0 ? box.y0 : dst.y0;
+	dst.x1 = box.x1 > dst.x1 ? box.x1 : dst.x1;
+	dst.y1 = box.y1 > dst.y1 ? box.y1 : dst.y1;
+}
+
+static void AddOverlapBox(OverlapTracker *tracker, OverlapBox const &box) {
+	if (tracker->count) {
+		OverlapBox &last = tracker->boxes[tracker->count - 1];
+		if (tracker->count == MAX_OVERLAP_BOXES || ExtendsLine(last, box)) {
+			MergeBox(last, box);
+			return;
+		}
+	}
+	tracker->boxes[tracker->count++] = box;
+}
+
+static bool OverlapsAny(OverlapTracker const *tracker, OverlapBox const &box) {
+	for (uint32_t i = 0; i < tracker->count; ++i) {
+		OverlapBox const &o = tracker->boxes[i];
+		if (box.x0 < o.x1 && box.x1 > o.x0 && box.y0 < o.y1 && box.y1 > o.y0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// adds a primitive to the command's runs, merging into the last run of the same kind or, if it
+// doesn't overlap the last run, into the run before that
+static bool AppendPrimitive(ImguiBindings_Context *ctx,
+														OverlapTracker *tracker,
+														uint32_t &runCount,
+														uint32_t cmdRunStart,
+														uint32_t cmdIndex,
+														bool quad,
+														uint32_t first,
+														uint32_t count,
+														uint32_t vertexBase,
+														OverlapBox const &box) {
+	if (runCount > cmdRunStart) {
+		QuadRun &last = ctx->quadRuns[runCount - 1];
+		if (last.quad == quad) {
+			last.count += count;
+			AddOverlapBox(tracker, box);
+			return true;
+		}
+
+		// runs alternate kinds, nothing of this kind has been added since the previous run so it's contiguous
+		if (runCount - 1 > cmdRunStart) {
+			QuadRun &previous = ctx->quadRuns[runCount - 2];
+			if (previous.first + previous.count == first && !OverlapsAny(tracker, box)) {
+				previous.count += count;
+				return true;
+			}
+		}
+	}
+
+	if (runCount == ctx->quadRunCapacity) {
+		uint32_t const newCapacity = ctx->quadRunCapacity ? ctx->quadRunCapacity * 2 : 1024;
+		auto runs = (QuadRun *) MEMORY_REALLOC(ctx->quadRuns, sizeof(QuadRun) * newCapacity);
+		if (!runs) {
+			return false;
+		}
+		ctx->quadRuns = runs;
+		ctx->quadRunCapacity = newCapacity;
+	}
+	ctx->quadRuns[runCount++] = {cmdIndex, quad, first, count, vertexBase};
+
+	tracker->count = 0;
+	AddOverlapBox(tracker, box);
+	return true;
+}
+
+// expands the quads starting at idx into out until one isn't a quad or maxQuads are done, returns how many
+static uint32_t ExpandQuads(ImDrawVert const *vtx, ImDrawIdx const *idx, uint32_t maxQuads, QuadInstance *out) {
+	uint32_t count = 0;
+	while (count < maxQuads && IsAxisAlignedQuad(vtx, idx + count * 6)) {
+		ImDrawVert const &a = vtx[idx[count * 6]];
+		ImDrawVert const &c = vtx[idx[count * 6 + 2]];
+		out[count++] = {
+				{a.pos.x, a.pos.y, c.pos.x, c.pos.y},
+				{PackUnorm16(a.uv.x), PackUnorm16(a.uv.y), PackUnorm16(c.uv.x), PackUnorm16(c.uv.y)},
+				a.col
+		};
+	}
+	return count;
+}
+
+static OverlapBox QuadBox(QuadInstance const &quad) {
+	float const *r = quad.rect;
+	return {r[0] < r[2] ? r[0] : r[2], r[1] < r[3] ? r[1] : r[3], r[0] < r[2] ? r[2] : r[0], r[1] < r[3] ? r[3] : r[1]};
+}
+
+static void UploadQuadBatch(ImguiBindings_Context *ctx,
+														QuadInstance const *batch,
+														uint32_t count,
+														uint64_t dstOffset) {
+	TheForge_BufferUpdateDesc const quadUpdate{
+			ctx->quadBuffer,
+			batch,
+			0,
+			dstOffset,
+			count * sizeof(QuadInstance)
+	};
+	TheForge_UpdateBuffer(&quadUpdate, true);
+}
+
+// splits every draw command into quad instances and triangle segments, merged into as few runs
+// as draw order allows, and returns the number of runs. Each list keeps its own window of the
+// vertex buffer like the normal path, triangle segments are copied straight from the list into it
+// and their indices upload unchanged, so a segment whose vertices aren't in index order (e.g. after
+// ImDrawListSplitter::Merge) just copies a wider range. Quads past the frame's instance limit take
+// the triangle path, lists that don't fit what's left of the frame are dropped.
+// Overlap boxes are only kept for a quad run that isn't its command's first, as only then can a
+// later triangle segment go before it, so commands of only quads skip them
+static uint32_t UploadQuadExpanded(ImguiBindings_Context *ctx,
+																	 DrawFrame const *frame,
+																	 uint64_t baseVertexOffset,
+																	 uint64_t baseIndexOffset,
+																	 uint64_t baseQuadOffset,
+																	 uint32_t *listCount) {
+	uint32_t const vertexLimit = (uint32_t) ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME - ctx->frameVertexCount;
+	uint32_t const indexLimit = (uint32_t) ImguiBindings_MAX_INDEX_COUNT_PER_FRAME - ctx->frameIndexCount;
+	uint32_t const quadLimit = (uint32_t) ImguiBindings_MAX_QUAD_COUNT_PER_FRAME - ctx->frameQuadCount;
+	uint32_t listVertexBase = 0;
+	uint32_t listIndexTotal = 0;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t quadCount = 0;
+	uint32_t runCount = 0;
+	uint32_t cmdIndex = 0;
+	bool outOfRuns = false;
+
+	QuadInstance batch[QUAD_BATCH_SIZE];
+	uint32_t batchCount = 0;
+
+	OverlapTracker tracker;
+	tracker.count = 0;
+	// the line of glyphs being added to the last run, kept out of the tracker until it ends
+	OverlapBox line{};
+	bool lineOpen = false;
+
+	*listCount = frame->listCount;
+	for (uint32_t n = 0; n < frame->listCount && !outOfRuns; n++) {
+		DrawListView const *cmdList = frame->lists + n;
+		if (listVertexBase + cmdList->vertexCount > vertexLimit || listIndexTotal + cmdList->indexCount > indexLimit) {
+			*listCount = n;
+			break;
+		}
+
+		for (uint32_t cmd_i = 0; cmd_i < cmdList->cmdCount && !outOfRuns; cmd_i++) {
+			const ImDrawCmd *imcmd = cmdList->cmds + cmd_i;
+			if (imcmd->UserCallback) {
+				continue;
+			}
+
+			ImDrawVert const *vtx = cmdList->vertices + imcmd->VtxOffset;
+			ImDrawIdx const *idx = cmdList->indices + imcmd->IdxOffset;
+			uint32_t const elemCount = imcmd->ElemCount;
+			uint32_t const vertexBase = listVertexBase + imcmd->VtxOffset;
+			uint32_t const cmdRunStart = runCount;
+			lineOpen = false;
+
+			for (uint32_t i = 0; i < elemCount && !outOfRuns;) {
+				if (batchCount == QUAD_BATCH_SIZE) {
+					UploadQuadBatch(ctx, batch, batchCount, baseQuadOffset + (quadCount - batchCount) * sizeof(QuadInstance));
+					batchCount = 0;
+				}
+
+				// a streak of quads, cut short by the batch filling up or the frame's instance limit
+				uint32_t maxQuads = (elemCount - i) / 6;
+				maxQuads = quadLimit - quadCount < maxQuads ? quadLimit - quadCount : maxQuads;
+				maxQuads = QUAD_BATCH_SIZE - batchCount < maxQuads ? QUAD_BATCH_SIZE - batchCount : maxQuads;
+				QuadInstance *quads = batch + batchCount;
+				uint32_t const expanded = ExpandQuads(vtx, idx + i, maxQuads, quads);
+				if (expanded) {
+					// quads go straight into the last run while that's a quad run, only tracking boxes if a later
+					// triangle segment could go before it. Otherwise one goes through AppendPrimitive and the
+					// rest see where it landed
+					for (uint32_t k = 0; k < expanded && !outOfRuns;) {
+						QuadRun *last = runCount > cmdRunStart ? ctx->quadRuns + runCount - 1 : nullptr;
+						if (!last || !last->quad) {
+							if (lineOpen) {
+								AddOverlapBox(&tracker, line);
+								lineOpen = false;
+							}
+							outOfRuns = !AppendPrimitive(ctx, &tracker, runCount, cmdRunStart, cmdIndex, true, quadCount + k, 1, 0,
+																					 QuadBox(quads[k]));
+							k++;
+							continue;
+						}
+
+						last->count += expanded - k;
+						if (runCount - 1 > cmdRunStart) {
+							for (; k < expanded; ++k) {
+								OverlapBox const box = QuadBox(quads[k]);
+								if (lineOpen && ExtendsLine(line, box)) {
+									MergeBox(line, box);
+								} else {
+									if (lineOpen) {
+										AddOverlapBox(&tracker, line);
+									}
+									line = box;
+									lineOpen = true;
+								}
+							}
+						}
+						k = expanded;
+					}
+					batchCount += expanded;
+					quadCount += expanded;
+					i += expanded * 6;
+					continue;
+				}
+
+				// a segment of triangles up to the next quad
+				uint32_t const segmentStart = i;
+				uint32_t minVertex = ~0u;
+				uint32_t maxVertex = 0;
+				do {
+					for (uint32_t k = 0; k < 3; ++k) {
+						uint32_t const v = idx[i + k];
+						minVertex = v < minVertex ? v : minVertex;
+						maxVertex = v > maxVertex ? v : maxVertex;
+					}
+					i += 3;
+				} while (i < elemCount && !(quadCount < quadLimit && i + 6 <= elemCount && IsAxisAlignedQuad(vtx, idx + i)));
+
+				uint32_t const segmentVertexCount = maxVertex - minVertex + 1;
+				uint32_t const segmentIndexCount = i - segmentStart;
+				TheForge_BufferUpdateDesc const vertexUpdate{
+						ctx->vertexBuffer,
+						vtx + minVertex,
+						0,
+						baseVertexOffset + (vertexBase + minVertex) * sizeof(ImDrawVert),
+						segmentVertexCount * sizeof(ImDrawVert)
+				};
+				TheForge_BufferUpdateDesc const indexUpdate{
+						ctx->indexBuffer,
+						idx + segmentStart,
+						0,
+						baseIndexOffset + indexCount * sizeof(ImDrawIdx),
+						segmentIndexCount * sizeof(ImDrawIdx)
+				};
+				TheForge_UpdateBuffer(&vertexUpdate, true);
+				TheForge_UpdateBuffer(&indexUpdate, true);
+
+				// only needed if there's an earlier run in the command to go before or to join
+				OverlapBox box{};
+				if (runCount > cmdRunStart) {
+					ImDrawVert const *src = vtx + minVertex;
+					box = {src->pos.x, src->pos.y, src->pos.x, src->pos.y};
+					for (uint32_t v = 1; v < segmentVertexCount; ++v) {
+						box.x0 = src[v].pos.x < box.x0 ? src[v].pos.x : box.x0;
+						box.y0 = src[v].pos.y < box.y0 ? src[v].pos.y : box.y0;
+						box.x1 = src[v].pos.x > box.x1 ? src[v].pos.x : box.x1;
+						box.y1 = src[v].pos.y > box.y1 ? src[v].pos.y : box.y1;
+					}
+				}
+				if (lineOpen) {
+					AddOverlapBox(&tracker, line);
+					lineOpen = false;
+				}
+				outOfRuns = !AppendPrimitive(ctx, &tracker, runCount, cmdRunStart, cmdIndex, false, indexCount,
+																		 segmentIndexCount, vertexBase, box);
+				vertexCount += segmentVertexCount;
+				indexCount += segmentIndexCount;
+			}
+			cmdIndex++;
+		}
+		listVertexBase += cmdList->vertexCount;
+		listIndexTotal += cmdList->indexCount;
+	}
+
+	if (batchCount) {
+		UploadQuadBatch(ctx, batch, batchCount, baseQuadOffset + (quadCount - batchCount) * sizeof(QuadInstance));
+	}
+
+	ctx->frameStats.vertexCount += vertexCount;
+	ctx->frameStats.indexCount += indexCount;
+	ctx->frameStats.quadInstanceCount += quadCount;
+	ctx->frameVertexCount += (listVertexBase + 1u) & ~1u;
+	ctx->frameIndexCount += (indexCount + 1u) & ~1u;
+	ctx->frameQuadCount += quadCount;
+	ctx->frameStats.uploadBytes += vertexCount * sizeof(ImDrawVert) + indexCount * sizeof(ImDrawIdx) +
+			quadCount * sizeof(QuadInstance);
+
+	return runCount;
+}
+
+AL2O3_EXTERN_C bool ImguiBindings_SetShaderClipping(ImguiBindings_ContextHandle handle, bool enable) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return false;
+	}
+
+	if (enable && !SetupMode(ctx, MD_ShaderClipping)) {
+		return false;
+	}
+
+	Thread_AtomicStore32Release(&ctx->shaderClipping, enable);
+	return true;
+}
+
+// builds the clip table and a clip index per vertex. Returns false if the frame has more unique
+// clip rects than the table holds, in which case it falls back to scissor rects
+static bool UploadClipTable(ImguiBindings_Context *ctx,
+														DrawFrame const *frame,
+														ImVec2 pos,
+														uint32_t callSlot,
+														uint64_t baseClipIndexOffset) {
+	uint32_t const vertexLimit = (uint32_t) ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME - ctx->frameVertexCount;
+	uint32_t clipCount = 0;
+	uint32_t listVertexBase = 0;
+	float *table = ctx->clipTableStaging;
+
+	for (uint32_t n = 0; n < frame->listCount; n++) {
+		DrawListView const *cmdList = frame->lists + n;
+
+		for (uint32_t cmd_i = 0; cmd_i < cmdList->cmdCount; cmd_i++) {
+			const ImDrawCmd *imcmd = cmdList->cmds + cmd_i;
+			if (imcmd->UserCallback) {
+				continue;
+			}
+
+			float const rect[4]{
+					imcmd->ClipRect.x * frame->framebufferScale.x - pos.x,
+					imcmd->ClipRect.y * frame->framebufferScale.y - pos.y,
+					imcmd->ClipRect.z * frame->framebufferScale.x - pos.x,
+					imcmd->ClipRect.w * frame->framebufferScale.y - pos.y,
+			};
+			// consecutive commands mostly share a clip rect
+			if (clipCount == 0 || memcmp(table + (clipCount - 1) * 4, rect, sizeof(rect)) != 0) {
+				if (clipCount == MAX_CLIP_RECTS_PER_FRAME) {
+					return false;
+				}
+				memcpy(table + clipCount * 4, rect, sizeof(rect));
+				clipCount++;
+			}
+
+			uint32_t const clipIndex = clipCount - 1;
+			uint32_t const vertexBase = listVertexBase + imcmd->VtxOffset;
+			ImDrawIdx const *idx = cmdList->indices + imcmd->IdxOffset;
+			for (uint32_t i = 0; i < imcmd->ElemCount; ++i) {
+				uint32_t const vertex = vertexBase + idx[i];
+				if (vertex < vertexLimit) {
+					ctx->clipIndexStaging[vertex] = clipIndex;
+				}
+			}
+		}
+		listVertexBase += cmdList->vertexCount;
+	}
+
+	uint32_t const vertexCount = listVertexBase < vertexLimit ? listVertexBase : vertexLimit;
+	if (vertexCount) {
+		TheForge_BufferUpdateDesc const clipIndexUpdate{
+				ctx->clipIndexBuffer,
+				ctx->clipIndexStaging,
+				0,
+				baseClipIndexOffset,
+				vertexCount * sizeof(uint32_t)
+		};
+		TheForge_UpdateBuffer(&clipIndexUpdate, true);
+	}
+	if (clipCount) {
+		TheForge_BufferUpdateDesc const clipTableUpdate{
+				ctx->clipTableBuffers[callSlot],
+				table,
+				0,
+				0,
+				clipCount * sizeof(float) * 4
+		};
+		TheForge_UpdateBuffer(&clipTableUpdate, false);
+	}
+
+	ctx->frameStats.clipRectCount += clipCount;
+	ctx->frameStats.uploadBytes += vertexCount * sizeof(uint32_t) + clipCount * sizeof(float) * 4;
+	return true;
+}
+
+// moves on to the next frame's region of the ring buffers, last used maxFrames frames ago
+static void AdvanceFrame(ImguiBindings_Context *ctx) {
+	ctx->currentFrame = (ctx->currentFrame + 1) % ctx->maxFrames;
+	ctx->frameCallCount = 0;
+	ctx->frameVertexCount = 0;
+	ctx->frameIndexCount = 0;
+	ctx->frameQuadCount = 0;
+	ctx->frameTextureChangeCount = 0;
+	ctx->frameMaskRectCount = 0;
+	ctx->stats = ctx->frameStats;
+	ctx->frameStats = {};
+
+	for (auto i = 0u; i < ctx->retiredMsaaTargetCount;) {
+		RetiredTarget &retired = ctx->retiredMsaaTargets[i];
+		if (--retired.framesLeft == 0) {
+			TheForge_RemoveRenderTarget(ctx->renderer, retired.target);
+			retired = ctx->retiredMsaaTargets[--ctx->retiredMsaaTargetCount];
+		} else {
+			++i;
+		}
+	}
+}
+
+// usedCallSlot (can be null) gets the render call slot this call took, it's left alone if the call
+// returns early without taking one
+static uint32_t RenderFrame(ImguiBindings_Context *ctx,
+													 TheForge_CmdHandle cmd,
+													 ImguiBindings_TargetDesc const *target,
+													 bool offscreen,
+													 DrawFrame const *frame,
+													 uint32_t *usedCallSlot) {
+	if (UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
+		return ctx->currentFrame;
+	}
+
+	PipelineVariant *variant = FindOrCreatePipelineVariant(ctx, target ? target : &ctx->defaultTarget, offscreen);
+	if (!variant) {
+		return ctx->currentFrame;
+	}
+	bool const quadExpansion = Thread_AtomicLoad32Acquire(&ctx->quadExpansion) != 0;
+	bool const shaderClipping = Thread_AtomicLoad32Acquire(&ctx->shaderClipping) != 0;
+	TheForge_PipelineHandle const quadPipeline = quadExpansion ? VariantPipeline(ctx, variant, PK_Quads) : nullptr;
+	if (quadExpansion && !quadPipeline) {
+		return ctx->currentFrame;
+	}
+	// without its pipeline shader clipping falls back to scissor rects
+	TheForge_PipelineHandle const clipPipeline =
+			(shaderClipping && !quadExpansion) ? VariantPipeline(ctx, variant, PK_Clip) : nullptr;
+	if (ctx->frameCallCount == ImguiBindings_MAX_RENDER_CALLS_PER_FRAME) {
+		return ctx->currentFrame;
+	}
+	uint32_t const callSlot = ctx->currentFrame * ImguiBindings_MAX_RENDER_CALLS_PER_FRAME + ctx->frameCallCount;
+	ctx->frameCallCount++;
+	if (usedCallSlot) {
+		*usedCallSlot = callSlot;
+	}
+	if (offscreen) {
+		ctx->frameStats.msaaSampleCount = target->sampleCount;
+	}
+
+	ImVec2 pos = frame->displayPos;
+	pos[0] *= frame->framebufferScale[0];
+	pos[1] *= frame->framebufferScale[1];
+
+	// Copy and convert all vertices into a single contiguous buffer, after what earlier calls this frame used
+	uint64_t const frameVertex = ctx->currentFrame * ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME + ctx->frameVertexCount;
+	uint64_t const frameIndex = ctx->currentFrame * ImguiBindings_MAX_INDEX_COUNT_PER_FRAME + ctx->frameIndexCount;
+	uint64_t const frameQuad = ctx->currentFrame * ImguiBindings_MAX_QUAD_COUNT_PER_FRAME + ctx->frameQuadCount;
+	uint64_t const baseVertexOffset = frameVertex * sizeof(ImDrawVert);
+	uint64_t const baseIndexOffset = frameIndex * sizeof(ImDrawIdx);
+	uint64_t const baseQuadOffset = frameQuad * sizeof(QuadInstance);
+	uint64_t const baseClipIndexOffset = frameVertex * sizeof(uint32_t);
+
+	uint32_t listCount = frame->listCount;
+	uint32_t const quadRunCount = quadExpansion ?
+																UploadQuadExpanded(ctx, frame, baseVertexOffset, baseIndexOffset, baseQuadOffset,
+																									 &listCount) : 0;
+
+	// quad instances don't carry a clip index, so quad expansion takes priority
+	bool const shaderClip = clipPipeline && UploadClipTable(ctx, frame, pos, callSlot, baseClipIndexOffset);
+
+	// lists that don't fit in what's left of the frame's buffers are dropped
+	uint32_t const vertexLimit = (uint32_t) ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME - ctx->frameVertexCount;
+	uint32_t const indexLimit = (uint32_t) ImguiBindings_MAX_INDEX_COUNT_PER_FRAME - ctx->frameIndexCount;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	for (uint32_t n = 0; n < frame->listCount && !quadExpansion; n++) {
+		// gather lists into single contigious buffers
+		DrawListView const *cmdList = frame->lists + n;
+
+		TheForge_BufferUpdateDesc const vertexUpdate{
+				ctx->vertexBuffer,
+				cmdList->vertices,
+				0,
 				baseVertexOffset + (vertexCount * sizeof(ImDrawVert)),
-				cmdList->VtxBuffer.Size * sizeof(ImDrawVert)
+				cmdList->vertexCount * sizeof(ImDrawVert)
 		};
 		TheForge_BufferUpdateDesc const indexUpdate{
 				ctx->indexBuffer,
-				cmdList->IdxBuffer.Data,
+				cmdList->indices,
 				0,
 				baseIndexOffset + (indexCount * sizeof(ImDrawIdx)),
-				(((cmdList->IdxBuffer.Size * sizeof(ImDrawIdx)) + 3u) & ~3u)
+				(((cmdList->indexCount * sizeof(ImDrawIdx)) + 3u) & ~3u)
 		};
 
-		vertexCount += (uint32_t) cmdList->VtxBuffer.Size;
-		indexCount += (uint32_t) cmdList->IdxBuffer.Size;
-
-		if (vertexCount > ImguiBindings_MAX_VERTEX_COUNT_PER_FRAME) {
-			break;
-		}
-		if (indexCount > ImguiBindings_MAX_INDEX_COUNT_PER_FRAME) {
+		if (vertexCount + cmdList->vertexCount > vertexLimit || indexCount + cmdList->indexCount > indexLimit) {
+			listCount = n;
 			break;
 		}
+		vertexCount += cmdList->vertexCount;
+		indexCount += cmdList->indexCount;
 
 		TheForge_UpdateBuffer(&vertexUpdate, true);
 		TheForge_UpdateBuffer(&indexUpdate, true);
-	}
 
-	float const left = drawData->DisplayPos.x;
-	float const right = drawData->DisplayPos.x + drawData->DisplaySize.x;
-	float const top = drawData->DisplayPos.y;
-	float const bottom = drawData->DisplayPos.y + drawData->DisplaySize.y;
+		ctx->frameStats.uploadBytes += vertexUpdate.size + indexUpdate.size;
+	}
+	ctx->frameStats.vertexCount += vertexCount;
+	ctx->frameStats.indexCount += indexCount;
+	ctx->frameVertexCount += (vertexCount + 1u) & ~1u;
+	ctx->frameIndexCount += (indexCount + 1u) & ~1u;
+
+	float const left = frame->displayPos.x;
+	float const right = frame->displayPos.x + frame->displaySize.x;
+	float const top = frame->displayPos.y;
+	float const bottom = frame->displayPos.y + frame->displaySize.y;
 	float const width = (right - left);
 	float const height = (top - bottom);
 	float const offX = (right + left) / (left - right);
@@ -645,7 +2334,7 @@ AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle,
 	};
 	memcpy(ctx->scaleOffsetMatrix, tmp, sizeof(float) * 16);
 	TheForge_BufferUpdateDesc const constantsUpdate{
-			ctx->uniformBuffers[ctx->currentFrame],
+			ctx->uniformBuffers[callSlot],
 			ctx->scaleOffsetMatrix,
 			0,
 			0,
@@ -653,35 +2342,59 @@ AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle,
 	};
 	TheForge_UpdateBuffer(&constantsUpdate, false);
 
-	TheForge_BufferBarrier barriers[] = {
+	TheForge_BufferBarrier barriers[3] = {
 			{ctx->vertexBuffer, TheForge_RS_VERTEX_AND_CONSTANT_BUFFER},
 			{ctx->indexBuffer, TheForge_RS_INDEX_BUFFER},
 	};
+	uint32_t barrierCount = 2;
+	if (quadExpansion) {
+		barriers[barrierCount++] = {ctx->quadBuffer, TheForge_RS_VERTEX_AND_CONSTANT_BUFFER};
+	}
+	if (shaderClip) {
+		barriers[barrierCount++] = {ctx->clipIndexBuffer, TheForge_RS_VERTEX_AND_CONSTANT_BUFFER};
+	}
 
-	TheForge_CmdResourceBarrier(cmd, 2, barriers, 0, nullptr);
+	TheForge_CmdResourceBarrier(cmd, barrierCount, barriers, 0, nullptr);
 
 	TheForge_CmdSetViewport(cmd, 0.0f, 0.0f,
-													drawData->DisplaySize.x * drawData->FramebufferScale.x,
-													drawData->DisplaySize.y * drawData->FramebufferScale.y,
+													frame->displaySize.x * frame->framebufferScale.x,
+													frame->displaySize.y * frame->framebufferScale.y,
 													0.0f, 1.0f);
 
-	ImVec2 pos = drawData->DisplayPos;
-	pos[0] *= drawData->FramebufferScale[0];
-	pos[1] *= drawData->FramebufferScale[1];
-
 	int lastVertexOffset = 0;
 	int lastIndexOffset = 0;
 
 	bool resetPipeline = true;
-	uint32_t textureChangesThisFrame = 0;
+	bool outOfTextureSets = false;
 	ImguiBindings_Texture const *lastTexture = nullptr;
+	TheForge_PipelineHandle lastPipeline = nullptr;
+	uint32_t cmdIndex = 0;
+	uint32_t quadRunIndex = 0;
+
+	// with shader clipping, contiguous commands sharing a texture are merged into one draw. A new draw
+	// list has a new vertex offset, so merging stops at list boundaries
+	TheForge_DescriptorSetHandle const uniformSet = shaderClip ? ctx->clipDescriptorSetUniform : ctx->descriptorSetUniform;
+	TheForge_DescriptorSetHandle const textureSet = shaderClip ? ctx->clipDescriptorSetTexture : ctx->descriptorSetTexture;
+	TheForge_BufferHandle clipVertexBuffers[]{ctx->vertexBuffer, ctx->clipIndexBuffer};
+	uint64_t const clipVertexOffsets[]{baseVertexOffset, baseClipIndexOffset};
+	uint32_t pendingIndexCount = 0;
+	uint32_t pendingFirstIndex = 0;
+	uint32_t pendingVertexOffset = 0;
+	auto flushPending = [&]() {
+		if (pendingIndexCount) {
+			TheForge_CmdDrawIndexed(cmd, pendingIndexCount, pendingFirstIndex, pendingVertexOffset);
+			ctx->frameStats.drawCalls++;
+			pendingIndexCount = 0;
+		}
+	};
 
-	for (int n = 0; n < drawData->CmdListsCount; n++) {
-		const ImDrawList *cmdList = drawData->CmdLists[n];
+	for (uint32_t n = 0; n < listCount && !outOfTextureSets; n++) {
+		DrawListView const *cmdList = frame->lists + n;
 
-		for (int cmd_i = 0; cmd_i < cmdList->CmdBuffer.size(); cmd_i++) {
-			const ImDrawCmd *imcmd = &cmdList->CmdBuffer[cmd_i];
+		for (uint32_t cmd_i = 0; cmd_i < cmdList->cmdCount; cmd_i++) {
+			const ImDrawCmd *imcmd = cmdList->cmds + cmd_i;
 			if (imcmd->UserCallback) {
+				flushPending();
 				if (imcmd->UserCallback == ImDrawCallback_ResetRenderState) {
 					resetPipeline = true;
 				}
@@ -689,66 +2402,358 @@ AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle,
 				// User callback (registered via ImDrawList::AddCallback)
 
 				// adjust the vertex and index offsets
+				// (with quad expansion the buffers are compacted, so these don't map to uploaded data)
 				ImDrawCmd tmp;
 				memcpy(&tmp, imcmd, sizeof(ImDrawCmd));
 				tmp.IdxOffset = lastIndexOffset + imcmd->IdxOffset;
 				tmp.VtxOffset = lastVertexOffset + imcmd->VtxOffset;
-				imcmd->UserCallback(cmdList, &tmp);
+				imcmd->UserCallback(cmdList->source, &tmp);
 
 				resetPipeline = true;
 			} else {
 				if (resetPipeline) {
-					TheForge_CmdBindPipeline(cmd, ctx->pipeline);
-					TheForge_CmdBindDescriptorSet(cmd, ctx->currentFrame, ctx->descriptorSetUniform);
+					lastPipeline = shaderClip ? clipPipeline : variant->pipeline;
+					TheForge_CmdBindPipeline(cmd, lastPipeline);
+					TheForge_CmdBindDescriptorSet(cmd, callSlot, uniformSet);
 					TheForge_CmdBindIndexBuffer(cmd, ctx->indexBuffer, baseIndexOffset);
-					TheForge_CmdBindVertexBuffer(cmd, 1, &ctx->vertexBuffer, &baseVertexOffset);
+					if (shaderClip) {
+						TheForge_CmdBindVertexBuffer(cmd, 2, clipVertexBuffers, clipVertexOffsets);
+						TheForge_CmdSetScissor(cmd, 0, 0,
+																	 (uint32_t) (frame->displaySize.x * frame->framebufferScale.x),
+																	 (uint32_t) (frame->displaySize.y * frame->framebufferScale.y));
+						ctx->frameStats.scissorChanges++;
+					} else {
+						TheForge_CmdBindVertexBuffer(cmd, 1, &ctx->vertexBuffer, &baseVertexOffset);
+					}
+					ctx->frameStats.pipelineBinds++;
 
 					resetPipeline = false;
 					lastTexture = nullptr;
 				}
-				float const clipX = imcmd->ClipRect.x * drawData->FramebufferScale.x;
-				float const clipY = imcmd->ClipRect.y * drawData->FramebufferScale.y;
-				float const clipZ = imcmd->ClipRect.z * drawData->FramebufferScale.x;
-				float const clipW = imcmd->ClipRect.w * drawData->FramebufferScale.y;
-
-				TheForge_CmdSetScissor(cmd,
-															 (uint32_t) (clipX - pos.x),
-															 (uint32_t) (clipY - pos.y),
-															 (uint32_t) (clipZ - clipX),
-															 (uint32_t) (clipW - clipY));
+				if (!shaderClip) {
+					float const clipX = imcmd->ClipRect.x * frame->framebufferScale.x;
+					float const clipY = imcmd->ClipRect.y * frame->framebufferScale.y;
+					float const clipZ = imcmd->ClipRect.z * frame->framebufferScale.x;
+					float const clipW = imcmd->ClipRect.w * frame->framebufferScale.y;
+
+					TheForge_CmdSetScissor(cmd,
+																 (uint32_t) (clipX - pos.x),
+																 (uint32_t) (clipY - pos.y),
+																 (uint32_t) (clipZ - clipX),
+																 (uint32_t) (clipW - clipY));
+					ctx->frameStats.scissorChanges++;
+				}
 
 				ImguiBindings_Texture const
 						*texture = imcmd->TextureId ? (ImguiBindings_Texture const *) imcmd->TextureId : nullptr;
 
 				if (texture != lastTexture) {
+					flushPending();
+					// the frame's texture descriptor sets are used up, the rest of this call isn't drawn
+					if (ctx->frameTextureChangeCount == ctx->maxTextureChangesPerFrame) {
+						outOfTextureSets = true;
+						break;
+					}
+
 					TheForge_DescriptorData descData{"colourTexture"};
 					descData.index = ~0;
 					descData.pTextures = &texture->gpu;
 					descData.count = 1;
-					uint32_t const setIndex = (ctx->maxTextureChangesPerFrame * ctx->currentFrame) + textureChangesThisFrame;
-					TheForge_UpdateDescriptorSet(ctx->renderer, setIndex, ctx->descriptorSetTexture, 1, &descData);
+					uint32_t const setIndex = (ctx->maxTextureChangesPerFrame * ctx->currentFrame) + ctx->frameTextureChangeCount;
+					TheForge_UpdateDescriptorSet(ctx->renderer, setIndex, textureSet, 1, &descData);
 
-					TheForge_CmdBindDescriptorSet(cmd, setIndex, ctx->descriptorSetTexture);
+					TheForge_CmdBindDescriptorSet(cmd, setIndex, textureSet);
 
 					lastTexture = texture;
-					textureChangesThisFrame++;
+					ctx->frameTextureChangeCount++;
+					ctx->frameStats.textureChanges++;
 				}
 
-				TheForge_CmdDrawIndexed(cmd, imcmd->ElemCount,
-																lastIndexOffset + imcmd->IdxOffset,
-																lastVertexOffset + imcmd->VtxOffset);
+				uint32_t const firstIndex = lastIndexOffset + imcmd->IdxOffset;
+				uint32_t const vertexOffset = lastVertexOffset + imcmd->VtxOffset;
+				if (shaderClip) {
+					if (pendingIndexCount &&
+							(pendingVertexOffset != vertexOffset || pendingFirstIndex + pendingIndexCount != firstIndex)) {
+						flushPending();
+					}
+					if (!pendingIndexCount) {
+						pendingFirstIndex = firstIndex;
+						pendingVertexOffset = vertexOffset;
+					}
+					pendingIndexCount += imcmd->ElemCount;
+				} else if (!quadExpansion) {
+					TheForge_CmdDrawIndexed(cmd, imcmd->ElemCount, firstIndex, vertexOffset);
+					ctx->frameStats.drawCalls++;
+				}
+
+				for (; quadRunIndex < quadRunCount && ctx->quadRuns[quadRunIndex].cmdIndex == cmdIndex; ++quadRunIndex) {
+					QuadRun const &run = ctx->quadRuns[quadRunIndex];
+					if (run.quad) {
+						if (lastPipeline != quadPipeline) {
+							TheForge_CmdBindPipeline(cmd, quadPipeline);
+							TheForge_CmdBindVertexBuffer(cmd, 1, &ctx->quadBuffer, &baseQuadOffset);
+							lastPipeline = quadPipeline;
+							ctx->frameStats.pipelineBinds++;
+						}
+						TheForge_CmdDrawInstanced(cmd, 6, 0, run.count, run.first);
+						ctx->frameStats.drawCalls++;
+					} else {
+						if (lastPipeline != variant->pipeline) {
+							TheForge_CmdBindPipeline(cmd, variant->pipeline);
+							TheForge_CmdBindVertexBuffer(cmd, 1, &ctx->vertexBuffer, &baseVertexOffset);
+							lastPipeline = variant->pipeline;
+							ctx->frameStats.pipelineBinds++;
+						}
+						TheForge_CmdDrawIndexed(cmd, run.count, run.first, run.vertexBase);
+						ctx->frameStats.drawCalls++;
+					}
+				}
+				cmdIndex++;
 			}
 		}
-		lastIndexOffset += cmdList->IdxBuffer.Size;
-		lastVertexOffset += cmdList->VtxBuffer.Size;
+		lastIndexOffset += cmdList->indexCount;
+		lastVertexOffset += cmdList->vertexCount;
 	}
+	flushPending();
+
 	uint32_t frameWeWroteTo = ctx->currentFrame;
 
-	// where we will write next frame data, which was last used N frame ago
-	ctx->currentFrame = (ctx->currentFrame + 1) % ctx->maxFrames;
+	// without BeginFrame each call is a frame of its own
+	if (!ctx->explicitFrames) {
+		AdvanceFrame(ctx);
+	}
 	return frameWeWroteTo;
 }
 
+// grow only, old contents are not preserved
+static bool EnsureCapacity(void **data, uint32_t *capacity, uint32_t needed, size_t elementSize) {
+	if (needed <= *capacity) {
+		return true;
+	}
+	uint32_t newCapacity = *capacity ? *capacity : 64;
+	while (newCapacity < needed) {
+		newCapacity *= 2;
+	}
+	MEMORY_FREE(*data);
+	*data = MEMORY_MALLOC(newCapacity * elementSize);
+	*capacity = *data ? newCapacity : 0;
+	return *data != nullptr;
+}
+
+static void SetFrameHeader(DrawFrame *frame, ImDrawData const *drawData) {
+	frame->displayPos = drawData->DisplayPos;
+	frame->displaySize = drawData->DisplaySize;
+	frame->framebufferScale = drawData->FramebufferScale;
+}
+
+// views the live ImGui::GetDrawData() without copying
+static bool BuildLiveFrame(ImguiBindings_Context *ctx, DrawFrame *frame) {
+	ImDrawData *drawData = ImGui::GetDrawData();
+	if (!drawData) {
+		return false;
+	}
+
+	if (!EnsureCapacity((void **) &ctx->liveLists,
+											&ctx->liveListCapacity,
+											(uint32_t) drawData->CmdListsCount,
+											sizeof(DrawListView))) {
+		return false;
+	}
+
+	for (int n = 0; n < drawData->CmdListsCount; n++) {
+		ImDrawList const *cmdList = drawData->CmdLists[n];
+		ctx->liveLists[n] = {
+				cmdList,
+				cmdList->CmdBuffer.Data,
+				cmdList->IdxBuffer.Data,
+				cmdList->VtxBuffer.Data,
+				(uint32_t) cmdList->CmdBuffer.Size,
+				(uint32_t) cmdList->IdxBuffer.Size,
+				(uint32_t) cmdList->VtxBuffer.Size,
+		};
+	}
+
+	SetFrameHeader(frame, drawData);
+	frame->lists = ctx->liveLists;
+	frame->listCount = (uint32_t) drawData->CmdListsCount;
+	return true;
+}
+
+static bool PrepareVariant(ImguiBindings_Context *ctx,
+													 ImguiBindings_TargetDesc const *target,
+													 bool offscreen,
+													 bool quadExpansion,
+													 bool shaderClipping) {
+	PipelineVariant *variant = FindOrCreatePipelineVariant(ctx, target, offscreen);
+	if (!variant) {
+		return false;
+	}
+	if (quadExpansion && !VariantPipeline(ctx, variant, PK_Quads)) {
+		return false;
+	}
+	if (shaderClipping && !VariantPipeline(ctx, variant, PK_Clip)) {
+		return false;
+	}
+	return true;
+}
+
+AL2O3_EXTERN_C bool ImguiBindings_PrepareTarget(ImguiBindings_ContextHandle handle,
+																								ImguiBindings_TargetDesc const *target) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !target) {
+		return false;
+	}
+	if (UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
+		return false;
+	}
+
+	// the modes are read once, a change on another thread meanwhile is picked up on first use
+	bool const quadExpansion = Thread_AtomicLoad32Acquire(&ctx->quadExpansion) != 0;
+	bool const shaderClipping = Thread_AtomicLoad32Acquire(&ctx->shaderClipping) != 0;
+	auto const msaaSampleCount = (TheForge_SampleCount) Thread_AtomicLoad32Acquire(&ctx->msaaSampleCount);
+
+	if (!PrepareVariant(ctx, target, false, quadExpansion, shaderClipping)) {
+		return false;
+	}
+	// RenderToTarget's offscreen pipelines and the resolve onto target
+	if (msaaSampleCount != TheForge_SC_1) {
+		ImguiBindings_TargetDesc const msaaTarget{target->format, msaaSampleCount, 0};
+		if (!PrepareVariant(ctx, &msaaTarget, true, quadExpansion, shaderClipping)) {
+			return false;
+		}
+		if (!FindOrCreateResolvePipeline(ctx, target)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+AL2O3_EXTERN_C void ImguiBindings_BeginFrame(ImguiBindings_ContextHandle handle) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return;
+	}
+
+	// the first call switches from a frame per render call, which already left a fresh frame current
+	if (ctx->explicitFrames) {
+		AdvanceFrame(ctx);
+	} else {
+		ctx->explicitFrames = true;
+	}
+}
+
+AL2O3_EXTERN_C uint32_t ImguiBindings_Render(ImguiBindings_ContextHandle handle,
+																						 TheForge_CmdHandle cmd,
+																						 ImguiBindings_TargetDesc const *target) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return 0;
+	}
+
+	DrawFrame frame;
+	if (!BuildLiveFrame(ctx, &frame)) {
+		return ctx->currentFrame;
+	}
+
+	return RenderFrame(ctx, cmd, target, false, &frame, nullptr);
+}
+
+AL2O3_EXTERN_C ImguiBindings_DrawDataSnapshotHandle ImguiBindings_CaptureDrawData(ImguiBindings_ContextHandle handle) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return nullptr;
+	}
+	ImDrawData const *drawData = ImGui::GetDrawData();
+	if (!drawData) {
+		return nullptr;
+	}
+
+	Thread_MutexAcquire(&ctx->snapshotMutex);
+	ImguiBindings_DrawDataSnapshot *snapshot = ctx->freeSnapshots;
+	if (snapshot) {
+		ctx->freeSnapshots = snapshot->nextFree;
+	}
+	Thread_MutexRelease(&ctx->snapshotMutex);
+
+	if (!snapshot) {
+		snapshot = (ImguiBindings_DrawDataSnapshot *) MEMORY_CALLOC(1, sizeof(ImguiBindings_DrawDataSnapshot));
+		if (!snapshot) {
+			return nullptr;
+		}
+	}
+	snapshot->nextFree = nullptr;
+
+	uint32_t cmdCount = 0;
+	for (int n = 0; n < drawData->CmdListsCount; n++) {
+		cmdCount += (uint32_t) drawData->CmdLists[n]->CmdBuffer.Size;
+	}
+
+	if (!EnsureCapacity((void **) &snapshot->lists, &snapshot->listCapacity,
+											(uint32_t) drawData->CmdListsCount, sizeof(DrawListView)) ||
+			!EnsureCapacity((void **) &snapshot->cmds, &snapshot->cmdCapacity,
+											cmdCount, sizeof(ImDrawCmd)) ||
+			!EnsureCapacity((void **) &snapshot->indices, &snapshot->indexCapacity,
+											(uint32_t) drawData->TotalIdxCount, sizeof(ImDrawIdx)) ||
+			!EnsureCapacity((void **) &snapshot->vertices, &snapshot->vertexCapacity,
+											(uint32_t) drawData->TotalVtxCount, sizeof(ImDrawVert))) {
+		ImguiBindings_ReleaseDrawDataSnapshot(ctx, snapshot);
+		return nullptr;
+	}
+
+	ImDrawCmd *cmds = snapshot->cmds;
+	ImDrawIdx *indices = snapshot->indices;
+	ImDrawVert *vertices = snapshot->vertices;
+	for (int n = 0; n < drawData->CmdListsCount; n++) {
+		ImDrawList const *cmdList = drawData->CmdLists[n];
+		memcpy(cmds, cmdList->CmdBuffer.Data, cmdList->CmdBuffer.Size * sizeof(ImDrawCmd));
+		memcpy(indices, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx));
+		memcpy(vertices, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert));
+		snapshot->lists[n] = {
+				nullptr,
+				cmds,
+				indices,
+				vertices,
+				(uint32_t) cmdList->CmdBuffer.Size,
+				(uint32_t) cmdList->IdxBuffer.Size,
+				(uint32_t) cmdList->VtxBuffer.Size,
+		};
+		cmds += cmdList->CmdBuffer.Size;
+		indices += cmdList->IdxBuffer.Size;
+		vertices += cmdList->VtxBuffer.Size;
+	}
+
+	SetFrameHeader(&snapshot->frame, drawData);
+	snapshot->frame.lists = snapshot->lists;
+	snapshot->frame.listCount = (uint32_t) drawData->CmdListsCount;
+
+	return snapshot;
+}
+
+AL2O3_EXTERN_C uint32_t ImguiBindings_RenderDrawDataSnapshot(ImguiBindings_ContextHandle handle,
+																														 TheForge_CmdHandle cmd,
+																														 ImguiBindings_TargetDesc const *target,
+																														 ImguiBindings_DrawDataSnapshotHandle snapshot) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !snapshot) {
+		return 0;
+	}
+
+	return RenderFrame(ctx, cmd, target, false, &snapshot->frame, nullptr);
+}
+
+AL2O3_EXTERN_C void ImguiBindings_ReleaseDrawDataSnapshot(ImguiBindings_ContextHandle handle,
+																													ImguiBindings_DrawDataSnapshotHandle snapshot) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !snapshot) {
+		return;
+	}
+
+	Thread_MutexAcquire(&ctx->snapshotMutex);
+	snapshot->nextFree = ctx->freeSnapshots;
+	ctx->freeSnapshots = snapshot;
+	Thread_MutexRelease(&ctx->snapshotMutex);
+}
+
 AL2O3_EXTERN_C float const *ImguiBindings_GetScaleOffsetMatrix(ImguiBindings_ContextHandle handle) {
 	auto ctx = (ImguiBindings_Context *) handle;
 	if (!ctx) {
@@ -758,3 +2763,358 @@ AL2O3_EXTERN_C float const *ImguiBindings_GetScaleOffsetMatrix(ImguiBindings_Con
 	return ctx->scaleOffsetMatrix;
 
 }
+
+AL2O3_EXTERN_C ImguiBindings_Stats const *ImguiBindings_GetStats(ImguiBindings_ContextHandle handle) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return nullptr;
+	}
+
+	return &ctx->stats;
+}
+
+// rects smaller than this (in pixels) on either axis aren't worth a mask draw
+static const float MIN_OPAQUE_RECT_SIZE = 16.0f;
+
+static void AddOpaqueRect(ImguiBindings_Context *ctx, ImguiBindings_Rect const &rect) {
+	for (auto i = 0u; i < ctx->opaqueRectCount; ++i) {
+		ImguiBindings_Rect const &o = ctx->opaqueRects[i];
+		if (rect.left >= o.left && rect.top >= o.top && rect.right <= o.right && rect.bottom <= o.bottom) {
+			return;
+		}
+	}
+	if (ctx->opaqueRectCount < ImguiBindings_MAX_OPAQUE_RECTS) {
+		ctx->opaqueRects[ctx->opaqueRectCount++] = rect;
+	}
+}
+
+AL2O3_EXTERN_C ImguiBindings_Rect const *ImguiBindings_ComputeOpaqueRects(ImguiBindings_ContextHandle handle,
+																																				 ImguiBindings_DrawDataSnapshotHandle snapshot,
+																																				 uint32_t *rectCount) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !rectCount) {
+		return nullptr;
+	}
+	*rectCount = 0;
+	ctx->opaqueRectCount = 0;
+	// the font worker may still be baking the atlas and its white pixel until creation finishes
+	if (UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
+		return ctx->opaqueRects;
+	}
+
+	DrawFrame liveFrame;
+	DrawFrame const *frame = &liveFrame;
+	if (snapshot) {
+		frame = &snapshot->frame;
+	} else if (!BuildLiveFrame(ctx, &liveFrame)) {
+		return ctx->opaqueRects;
+	}
+
+	ImVec2 const scale = frame->framebufferScale;
+	ImVec2 pos = frame->displayPos;
+	pos[0] *= scale[0];
+	pos[1] *= scale[1];
+	ctx->opaqueTargetWidth = frame->displaySize.x * scale.x;
+	ctx->opaqueTargetHeight = frame->displaySize.y * scale.y;
+
+	// only solid fills (the atlas white pixel) at full alpha are known to be opaque
+	ImVec2 const white = ctx->fontAtlas->TexUvWhitePixel;
+	for (uint32_t n = 0; n < frame->listCount; n++) {
+		DrawListView const *cmdList = frame->lists + n;
+
+		for (uint32_t cmd_i = 0; cmd_i < cmdList->cmdCount; cmd_i++) {
+			const ImDrawCmd *imcmd = cmdList->cmds + cmd_i;
+			if (imcmd->UserCallback || imcmd->TextureId != (void *) &ctx->fontTexture) {
+				continue;
+			}
+
+			ImDrawVert const *vtx = cmdList->vertices + imcmd->VtxOffset;
+			ImDrawIdx const *idx = cmdList->indices + imcmd->IdxOffset;
+			for (uint32_t i = 0; i + 6 <= imcmd->ElemCount; i += 3) {
+				if (!IsAxisAlignedQuad(vtx, idx + i)) {
+					continue;
+				}
+				ImDrawVert const &a = vtx[idx[i]];
+				ImDrawVert const &c = vtx[idx[i + 2]];
+				if ((a.col >> 24u) != 0xFF ||
+						a.uv.x != white.x || a.uv.y != white.y || c.uv.x != white.x || c.uv.y != white.y) {
+					continue;
+				}
+
+				// clip, convert to target pixels and shrink to whole pixels so it stays conservative
+				float const x0 = fmaxf(fminf(a.pos.x, c.pos.x), imcmd->ClipRect.x) * scale.x - pos.x;
+				float const y0 = fmaxf(fminf(a.pos.y, c.pos.y), imcmd->ClipRect.y) * scale.y - pos.y;
+				float const x1 = fminf(fmaxf(a.pos.x, c.pos.x), imcmd->ClipRect.z) * scale.x - pos.x;
+				float const y1 = fminf(fmaxf(a.pos.y, c.pos.y), imcmd->ClipRect.w) * scale.y - pos.y;
+				ImguiBindings_Rect const rect{ceilf(x0), ceilf(y0), floorf(x1), floorf(y1)};
+				if (rect.right - rect.left >= MIN_OPAQUE_RECT_SIZE && rect.bottom - rect.top >= MIN_OPAQUE_RECT_SIZE) {
+					AddOpaqueRect(ctx, rect);
+				}
+				i += 3;
+			}
+		}
+	}
+
+	*rectCount = ctx->opaqueRectCount;
+	return ctx->opaqueRects;
+}
+
+AL2O3_EXTERN_C void ImguiBindings_RenderOpaqueMask(ImguiBindings_ContextHandle handle,
+																									 TheForge_CmdHandle cmd,
+																									 ImguiBindings_TargetDesc const *depthTarget,
+																									 uint32_t depthTargetWidth,
+																									 uint32_t depthTargetHeight,
+																									 float depth) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !depthTarget || ctx->opaqueRectCount == 0 || depthTargetWidth == 0 || depthTargetHeight == 0) {
+		return;
+	}
+	if (ctx->opaqueTargetWidth <= 0.0f || ctx->opaqueTargetHeight <= 0.0f) {
+		return;
+	}
+
+	// rects share the frame's region of the mask buffer with earlier masks this frame, extras are dropped
+	uint32_t const rectCount = ctx->opaqueRectCount < ImguiBindings_MAX_OPAQUE_RECTS - ctx->frameMaskRectCount ?
+														 ctx->opaqueRectCount : ImguiBindings_MAX_OPAQUE_RECTS - ctx->frameMaskRectCount;
+	if (rectCount == 0) {
+		return;
+	}
+	if (!SetupMode(ctx, MD_OpaqueMask)) {
+		return;
+	}
+
+	TheForge_PipelineHandle pipeline = FindOrCreateMaskPipeline(ctx, depthTarget);
+	if (!pipeline) {
+		return;
+	}
+
+	// the rects are in UI target pixels, scale them to the depth target and shrink to whole pixels
+	// again so they stay conservative when the sizes differ
+	float const width = (float) depthTargetWidth;
+	float const height = (float) depthTargetHeight;
+	float const scaleX = width / ctx->opaqueTargetWidth;
+	float const scaleY = height / ctx->opaqueTargetHeight;
+
+	float vertices[ImguiBindings_MAX_OPAQUE_RECTS * MASK_VERTICES_PER_RECT * 3];
+	float *v = vertices;
+	uint32_t drawnCount = 0;
+	for (auto i = 0u; i < rectCount; ++i) {
+		ImguiBindings_Rect const &r = ctx->opaqueRects[i];
+		float const left = ceilf(r.left * scaleX);
+		float const right = floorf(r.right * scaleX);
+		float const top = ceilf(r.top * scaleY);
+		float const bottom = floorf(r.bottom * scaleY);
+		// scaled down far enough a rect can round to nothing, or inside out which would still draw
+		if (right <= left || bottom <= top) {
+			continue;
+		}
+		float const x0 = (left / width) * 2.0f - 1.0f;
+		float const x1 = (right / width) * 2.0f - 1.0f;
+		float const y0 = 1.0f - (top / height) * 2.0f;
+		float const y1 = 1.0f - (bottom / height) * 2.0f;
+		float const quad[MASK_VERTICES_PER_RECT * 3]{
+				x0, y0, depth, x1, y0, depth, x1, y1, depth,
+				x0, y0, depth, x1, y1, depth, x0, y1, depth,
+		};
+		memcpy(v, quad, sizeof(quad));
+		v += MASK_VERTICES_PER_RECT * 3;
+		drawnCount++;
+	}
+	if (drawnCount == 0) {
+		return;
+	}
+
+	uint32_t const vertexCount = drawnCount * MASK_VERTICES_PER_RECT;
+	uint64_t const baseOffset = (ctx->currentFrame * ImguiBindings_MAX_OPAQUE_RECTS + ctx->frameMaskRectCount) *
+			MASK_VERTICES_PER_RECT * MASK_VERTEX_SIZE;
+	ctx->frameMaskRectCount += drawnCount;
+	TheForge_BufferUpdateDesc const maskUpdate{
+			ctx->maskVertexBuffer,
+			vertices,
+			0,
+			baseOffset,
+			vertexCount * MASK_VERTEX_SIZE
+	};
+	TheForge_UpdateBuffer(&maskUpdate, true);
+
+	TheForge_BufferBarrier barrier{ctx->maskVertexBuffer, TheForge_RS_VERTEX_AND_CONSTANT_BUFFER};
+	TheForge_CmdResourceBarrier(cmd, 1, &barrier, 0, nullptr);
+
+	TheForge_CmdSetViewport(cmd, 0.0f, 0.0f, width, height, 0.0f, 1.0f);
+	TheForge_CmdSetScissor(cmd, 0, 0, depthTargetWidth, depthTargetHeight);
+	TheForge_CmdBindPipeline(cmd, pipeline);
+	TheForge_CmdBindVertexBuffer(cmd, 1, &ctx->maskVertexBuffer, &baseOffset);
+	TheForge_CmdDraw(cmd, vertexCount, 0);
+}
+
+// hands the current MSAA target to AdvanceFrame to remove once no frame in flight can use it
+static void RetireMSAATarget(ImguiBindings_Context *ctx) {
+	if (!ctx->msaaTarget) {
+		return;
+	}
+	if (ctx->retiredMsaaTargetCount == MAX_RETIRED_MSAA_TARGETS) {
+		LOGWARNING("ImguiBindings: MSAA target replaced too often, removing it while it may be in flight");
+		TheForge_RemoveRenderTarget(ctx->renderer, ctx->msaaTarget);
+	} else {
+		ctx->retiredMsaaTargets[ctx->retiredMsaaTargetCount++] = {ctx->msaaTarget, ctx->maxFrames};
+	}
+	ctx->msaaTarget = nullptr;
+}
+
+AL2O3_EXTERN_C bool ImguiBindings_SetMSAAMode(ImguiBindings_ContextHandle handle, TheForge_SampleCount sampleCount) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx) {
+		return false;
+	}
+	auto const previous = (TheForge_SampleCount) Thread_AtomicLoad32Relaxed(&ctx->msaaSampleCount);
+	if (sampleCount == previous) {
+		return true;
+	}
+	if (sampleCount != TheForge_SC_1 && !SetupMode(ctx, MD_MSAA)) {
+		return false;
+	}
+
+	ImGuiContext *previousContext = ImGui::GetCurrentContext();
+	ImGui::SetCurrentContext(ctx->context);
+	ImGuiStyle &style = ImGui::GetStyle();
+	if (previous == TheForge_SC_1) {
+		ctx->savedAntiAliasedLines = style.AntiAliasedLines;
+		ctx->savedAntiAliasedFill = style.AntiAliasedFill;
+	}
+	if (sampleCount == TheForge_SC_1) {
+		style.AntiAliasedLines = ctx->savedAntiAliasedLines;
+		style.AntiAliasedFill = ctx->savedAntiAliasedFill;
+	} else {
+		// MSAA smooths the edges, the fringe geometry would just be extra vertices
+		style.AntiAliasedLines = false;
+		style.AntiAliasedFill = false;
+	}
+	ImGui::SetCurrentContext(previousContext);
+
+	Thread_AtomicStore32Release(&ctx->msaaSampleCount, sampleCount);
+	return true;
+}
+
+// render thread only. Replaces the MSAA target when the size, format or sample count has changed
+static bool EnsureMSAATarget(ImguiBindings_Context *ctx,
+														 TheForge_RenderTargetDesc const *targetDesc,
+														 TheForge_SampleCount sampleCount) {
+	if (ctx->msaaTarget) {
+		TheForge_RenderTargetDesc const *msaaDesc = TheForge_RenderTargetGetDesc(ctx->msaaTarget);
+		if (msaaDesc->width == targetDesc->width &&
+				msaaDesc->height == targetDesc->height &&
+				msaaDesc->format == targetDesc->format &&
+				msaaDesc->sampleCount == sampleCount) {
+			return true;
+		}
+		RetireMSAATarget(ctx);
+	}
+
+	TheForge_RenderTargetDesc const &failed = ctx->failedMsaaDesc;
+	if (failed.width == targetDesc->width &&
+			failed.height == targetDesc->height &&
+			failed.format == targetDesc->format &&
+			failed.sampleCount == sampleCount) {
+		return false;
+	}
+
+	TheForge_RenderTargetDesc msaaDesc{};
+	msaaDesc.width = targetDesc->width;
+	msaaDesc.height = targetDesc->height;
+	msaaDesc.depth = 1;
+	msaaDesc.arraySize = 1;
+	msaaDesc.mipLevels = 1;
+	msaaDesc.sampleCount = sampleCount;
+	msaaDesc.sampleQuality = 0;
+	msaaDesc.format = targetDesc->format;
+	msaaDesc.clearValue = {0.0f, 0.0f, 0.0f, 0.0f};
+	msaaDesc.descriptors = TheForge_DESCRIPTOR_TYPE_TEXTURE;
+	msaaDesc.debugName = "ImguiBindings_MSAATarget";
+	TheForge_AddRenderTarget(ctx->renderer, &msaaDesc, &ctx->msaaTarget);
+	if (!ctx->msaaTarget) {
+		LOGWARNING("ImguiBindings: couldn't create a %ux%u MSAA target at %u samples, drawing without MSAA",
+							 msaaDesc.width, msaaDesc.height, (uint32_t) sampleCount);
+		ctx->failedMsaaDesc = msaaDesc;
+		return false;
+	}
+	return true;
+}
+
+AL2O3_EXTERN_C uint32_t ImguiBindings_RenderToTarget(ImguiBindings_ContextHandle handle,
+																										 TheForge_CmdHandle cmd,
+																										 TheForge_RenderTargetHandle target,
+																										 ImguiBindings_DrawDataSnapshotHandle snapshot) {
+	auto ctx = (ImguiBindings_Context *) handle;
+	if (!ctx || !target) {
+		return 0;
+	}
+	if (UpdateCreateStatus(ctx) != ImguiBindings_CS_Ready) {
+		return ctx->currentFrame;
+	}
+
+	DrawFrame liveFrame;
+	DrawFrame const *frame = &liveFrame;
+	if (snapshot) {
+		frame = &snapshot->frame;
+	} else if (!BuildLiveFrame(ctx, &liveFrame)) {
+		return ctx->currentFrame;
+	}
+
+	TheForge_RenderTargetDesc const *targetDesc = TheForge_RenderTargetGetDesc(target);
+	ImguiBindings_TargetDesc const finalTarget{targetDesc->format, targetDesc->sampleCount, targetDesc->sampleQuality};
+
+	auto const msaaSampleCount = (TheForge_SampleCount) Thread_AtomicLoad32Acquire(&ctx->msaaSampleCount);
+	if (msaaSampleCount == TheForge_SC_1) {
+		// MSAA mode was turned off, let go of its target
+		RetireMSAATarget(ctx);
+	}
+	TheForge_LoadActionsDesc loadActions{};
+	if (msaaSampleCount == TheForge_SC_1 || ctx->frameCallCount == ImguiBindings_MAX_RENDER_CALLS_PER_FRAME ||
+			!EnsureMSAATarget(ctx, targetDesc, msaaSampleCount)) {
+		loadActions.loadActionsColor[0] = TheForge_LA_LOAD;
+		TheForge_CmdBindRenderTargets(cmd, 1, &target, nullptr, &loadActions, nullptr, nullptr, ~0u, ~0u);
+		return RenderFrame(ctx, cmd, &finalTarget, false, frame, nullptr);
+	}
+
+	TheForge_PipelineHandle resolvePipeline = FindOrCreateResolvePipeline(ctx, &finalTarget);
+	if (!resolvePipeline) {
+		return ctx->currentFrame;
+	}
+
+	TheForge_TextureHandle msaaTexture = TheForge_RenderTargetGetTexture(ctx->msaaTarget);
+	TheForge_TextureBarrier barrier{msaaTexture, TheForge_RS_RENDER_TARGET};
+	TheForge_CmdResourceBarrier(cmd, 0, nullptr, 1, &barrier);
+
+	loadActions.loadActionsColor[0] = TheForge_LA_CLEAR;
+	loadActions.clearColorValues[0] = {0.0f, 0.0f, 0.0f, 0.0f};
+	TheForge_CmdBindRenderTargets(cmd, 1, &ctx->msaaTarget, nullptr, &loadActions, nullptr, nullptr, ~0u, ~0u);
+
+	ImguiBindings_TargetDesc const msaaTarget{targetDesc->format, msaaSampleCount, 0};
+	uint32_t resolveSet = ~0u;
+	uint32_t const frameIndex = RenderFrame(ctx, cmd, &msaaTarget, true, frame, &resolveSet);
+
+	barrier.state = TheForge_RS_SHADER_RESOURCE;
+	TheForge_CmdResourceBarrier(cmd, 0, nullptr, 1, &barrier);
+
+	loadActions.loadActionsColor[0] = TheForge_LA_LOAD;
+	TheForge_CmdBindRenderTargets(cmd, 1, &target, nullptr, &loadActions, nullptr, nullptr, ~0u, ~0u);
+	// nothing was drawn and no call slot was taken for the resolve set
+	if (resolveSet == ~0u) {
+		return frameIndex;
+	}
+
+	// the resolve set shares the render call's slot, so it isn't rewritten while this frame is in flight
+	TheForge_DescriptorData descData{"msaaTexture"};
+	descData.index = ~0;
+	descData.pTextures = &msaaTexture;
+	descData.count = 1;
+	TheForge_UpdateDescriptorSet(ctx->renderer, resolveSet, ctx->resolveDescriptorSet, 1, &descData);
+
+	TheForge_CmdSetViewport(cmd, 0.0f, 0.0f, (float) targetDesc->width, (float) targetDesc->height, 0.0f, 1.0f);
+	TheForge_CmdSetScissor(cmd, 0, 0, targetDesc->width, targetDesc->height);
+	TheForge_CmdBindPipeline(cmd, resolvePipeline);
+	TheForge_CmdBindDescriptorSet(cmd, resolveSet, ctx->resolveDescriptorSet);
+	TheForge_CmdDraw(cmd, 3, 0);
+
+	return frameIndex;
+}